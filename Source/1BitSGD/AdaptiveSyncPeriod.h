@@ -0,0 +1,87 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// AdaptiveSyncPeriodController -- picks the number of samples per worker between
+// model synchronizations from the measured cost of synchronizing and of training.
+// The period is chosen such that the time spent synchronizing is 'targetRatio'
+// times the time spent on local training: a congested network makes blocks longer,
+// an idle one shorter. Measurements are smoothed and the period changes by at most
+// a factor of 'maxStepFactor' per synchronization, within [minPeriod, maxPeriod].
+// The controller is deterministic, so workers fed with the same (aggregated)
+// measurements agree on the period without further communication.
+// =======================================================================
+
+class AdaptiveSyncPeriodController
+{
+public:
+    AdaptiveSyncPeriodController(double targetRatio, size_t minPeriod, size_t maxPeriod, double smoothing = 0.3, double maxStepFactor = 2.0)
+        : m_targetRatio(targetRatio), m_minPeriod(std::max<size_t>(minPeriod, 1)), m_maxPeriod(std::max(maxPeriod, std::max<size_t>(minPeriod, 1))),
+        m_smoothing(smoothing), m_maxStepFactor(std::max(maxStepFactor, 1.0)), m_syncSeconds(0), m_secondsPerSample(0), m_hasMeasurements(false)
+    {
+        if (targetRatio <= 0)
+            InvalidArgument("AdaptiveSyncPeriodController: the target ratio of synchronization to training time must be positive.");
+    }
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(AdaptiveSyncPeriodController);
+
+    // Returns the period to use after a block of 'blockSamples' samples per worker that took 'computeSeconds'
+    // of local training, where the last synchronization took 'syncSeconds'. 'period' is the current period.
+    size_t Update(size_t period, double blockSamples, double syncSeconds, double computeSeconds)
+    {
+        if (blockSamples <= 0 || syncSeconds <= 0 || computeSeconds <= 0)
+            return Clamp(period);
+
+        double secondsPerSample = computeSeconds / blockSamples;
+        if (m_hasMeasurements)
+        {
+            m_syncSeconds = m_smoothing * syncSeconds + (1 - m_smoothing) * m_syncSeconds;
+            m_secondsPerSample = m_smoothing * secondsPerSample + (1 - m_smoothing) * m_secondsPerSample;
+        }
+        else
+        {
+            m_syncSeconds = syncSeconds;
+            m_secondsPerSample = secondsPerSample;
+            m_hasMeasurements = true;
+        }
+
+        double target = m_syncSeconds / (m_targetRatio * m_secondsPerSample);
+        target = std::min(std::max(target, period / m_maxStepFactor), period * m_maxStepFactor);
+        return Clamp((size_t)std::llround(target));
+    }
+
+    void Reset()
+    {
+        m_hasMeasurements = false;
+    }
+
+    size_t Clamp(size_t period) const
+    {
+        return std::min(std::max(period, m_minPeriod), m_maxPeriod);
+    }
+
+private:
+    const double m_targetRatio;
+    const size_t m_minPeriod;
+    const size_t m_maxPeriod;
+    const double m_smoothing;
+    const double m_maxStepFactor;
+
+    // Moving averages of the synchronization time and of the training time per sample.
+    double m_syncSeconds;
+    double m_secondsPerSample;
+    bool m_hasMeasurements;
+};
+
+} } }
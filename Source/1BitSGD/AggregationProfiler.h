@@ -0,0 +1,299 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// AggregationProfiler -- low overhead timing of the phases of a gradient aggregation.
+// Each thread records into its own ring buffer, so recording takes no locks;
+// only the first record of a thread registers its buffer. When the profiler is
+// disabled a record, and taking a timestamp for one, cost a single atomic load.
+// Records can be queried as a snapshot or a per-phase summary, and dumped as CSV or JSON.
+// =======================================================================
+
+enum class AggregationPhase : int
+{
+    Quantize,              // Waiting for the quantization of the gradients
+    SendPost,              // Posting the sends of the quantized stripes
+    StripeArrival,         // Arrival of a stripe from a peer, measured from the start of the exchange
+    UnquantizeAccumulate,  // Unquantizing and accumulating a received stripe
+    Requantize,            // Waiting for the quantization of the aggregated stripe
+    Allgather,             // Receiving the aggregated stripes from the other nodes
+    FinalUnquantize,       // Unquantizing the aggregated gradients
+    Header,                // Aggregating the header
+    ModelAggregation,      // Aggregating the block gradients of model averaging (BMUF)
+    ModelUpdate,           // Applying the aggregated block gradients to the model (BMUF)
+    Total,                 // The whole aggregation
+    NumPhases
+};
+
+inline const char* AggregationPhaseName(AggregationPhase phase)
+{
+    static const char* names[] = { "quantize", "sendPost", "stripeArrival", "unquantizeAccumulate", "requantize", "allgather", "finalUnquantize", "header", "modelAggregation", "modelUpdate", "total" };
+    return ((int)phase >= 0 && phase < AggregationPhase::NumPhases) ? names[(int)phase] : "unknown";
+}
+
+struct AggregationPhaseRecord
+{
+    AggregationPhase m_phase;
+    int m_peer;            // Rank of the peer the record refers to, -1 if not peer specific
+    size_t m_iteration;
+    size_t m_thread;       // Index of the recording thread, in order of first record
+    long long m_beginNs;   // Relative to the profiler epoch
+    long long m_endNs;
+};
+
+struct AggregationPhaseSummary
+{
+    size_t m_count = 0;
+    double m_totalSeconds = 0;
+    double m_minSeconds = 0;
+    double m_maxSeconds = 0;
+};
+
+class AggregationProfiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    struct ThreadBuffer
+    {
+        ThreadBuffer(size_t index, size_t capacity)
+            : m_index(index), m_records(capacity), m_numRecorded(0)
+        {}
+
+        size_t m_index;
+        std::vector<AggregationPhaseRecord> m_records;
+        std::atomic<size_t> m_numRecorded;
+    };
+
+public:
+    static AggregationProfiler& Get()
+    {
+        static AggregationProfiler profiler;
+        return profiler;
+    }
+
+    // 'ringCapacity' is the number of records kept per thread; it applies to threads that record for the first time.
+    void Enable(bool enable, size_t ringCapacity = 16384)
+    {
+        m_ringCapacity = std::max<size_t>(ringCapacity, 1);
+        m_enabled.store(enable, std::memory_order_release);
+    }
+
+    bool IsEnabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    // Only every 'samplingPeriod'-th aggregation is recorded; 0 and 1 record all of them.
+    void SetSamplingPeriod(size_t samplingPeriod)
+    {
+        m_samplingPeriod.store(samplingPeriod, std::memory_order_relaxed);
+    }
+
+    // Restarts the clock: the current time becomes the origin of all timestamps. Done by all ranks right
+    // after a barrier, their timestamps are comparable up to the skew with which they leave the barrier.
+    void RestartClock()
+    {
+        m_clockOffsetNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_epoch).count(), std::memory_order_relaxed);
+    }
+
+    // Starts a new aggregation; subsequent records are tagged with the returned iteration.
+    size_t BeginIteration()
+    {
+        return ++m_iteration;
+    }
+
+    size_t CurrentIteration() const
+    {
+        return m_iteration.load(std::memory_order_relaxed);
+    }
+
+    // Nanoseconds since the profiler epoch, or since the last RestartClock. Always 0 while the profiler is disabled.
+    long long Now() const
+    {
+        if (!IsEnabled())
+            return 0;
+
+        return Timestamp(Clock::now());
+    }
+
+    // The timestamp of a time taken earlier, e.g. when a request was found complete.
+    long long Timestamp(Clock::time_point time) const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_epoch).count() - m_clockOffsetNs.load(std::memory_order_relaxed);
+    }
+
+    void Record(AggregationPhase phase, int peer, long long beginNs, long long endNs)
+    {
+        if (!IsEnabled())
+            return;
+
+        size_t samplingPeriod = m_samplingPeriod.load(std::memory_order_relaxed);
+        if (samplingPeriod > 1 && (CurrentIteration() % samplingPeriod) != 0)
+            return;
+
+        ThreadBuffer& buffer = CurrentThreadBuffer();
+        size_t numRecorded = buffer.m_numRecorded.load(std::memory_order_relaxed);
+        AggregationPhaseRecord& record = buffer.m_records[numRecorded % buffer.m_records.size()];
+        record.m_phase = phase;
+        record.m_peer = peer;
+        record.m_iteration = CurrentIteration();
+        record.m_thread = buffer.m_index;
+        record.m_beginNs = beginNs;
+        record.m_endNs = endNs;
+        buffer.m_numRecorded.store(numRecorded + 1, std::memory_order_release);
+    }
+
+    // Returns the records still held by the ring buffers, ordered by begin time.
+    // Records written concurrently with the snapshot may be torn; take snapshots between aggregations.
+    std::vector<AggregationPhaseRecord> Snapshot() const
+    {
+        std::vector<AggregationPhaseRecord> records;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& buffer : m_buffers)
+        {
+            size_t numRecorded = buffer->m_numRecorded.load(std::memory_order_acquire);
+            size_t capacity = buffer->m_records.size();
+            for (size_t i = (numRecorded > capacity) ? (numRecorded - capacity) : 0; i < numRecorded; ++i)
+                records.push_back(buffer->m_records[i % capacity]);
+        }
+
+        std::sort(records.begin(), records.end(), [](const AggregationPhaseRecord& a, const AggregationPhaseRecord& b) { return a.m_beginNs < b.m_beginNs; });
+        return records;
+    }
+
+    // Per-phase statistics over the held records, restricted to one iteration unless 'iteration' is 0.
+    std::vector<AggregationPhaseSummary> Summary(size_t iteration = 0) const
+    {
+        std::vector<AggregationPhaseSummary> summary((size_t)AggregationPhase::NumPhases);
+        for (const auto& record : Snapshot())
+        {
+            if (iteration != 0 && record.m_iteration != iteration)
+                continue;
+
+            double seconds = (record.m_endNs - record.m_beginNs) * 1e-9;
+            auto& phase = summary[(size_t)record.m_phase];
+            phase.m_minSeconds = (phase.m_count == 0) ? seconds : std::min(phase.m_minSeconds, seconds);
+            phase.m_maxSeconds = (phase.m_count == 0) ? seconds : std::max(phase.m_maxSeconds, seconds);
+            phase.m_totalSeconds += seconds;
+            phase.m_count++;
+        }
+
+        return summary;
+    }
+
+    // Prints the total time spent in each phase of the given iteration, in the style of the sync perf stats.
+    void PrintSummary(FILE* file, size_t iteration) const
+    {
+        auto summary = Summary(iteration);
+        fprintf(file, "Gradient aggregation phases:");
+        for (size_t i = 0; i < summary.size(); ++i)
+        {
+            if (summary[i].m_count > 0)
+                fprintf(file, " %s=%.6g(%d)", AggregationPhaseName((AggregationPhase)i), summary[i].m_totalSeconds, (int)summary[i].m_count);
+        }
+
+        fprintf(file, "\n");
+    }
+
+    void DumpCsv(FILE* file) const
+    {
+        fprintf(file, "iteration,thread,phase,peer,beginNs,endNs\n");
+        for (const auto& record : Snapshot())
+            fprintf(file, "%llu,%d,%s,%d,%lld,%lld\n", (unsigned long long)record.m_iteration, (int)record.m_thread, AggregationPhaseName(record.m_phase), record.m_peer, record.m_beginNs, record.m_endNs);
+    }
+
+    void DumpJson(FILE* file) const
+    {
+        auto records = Snapshot();
+        fprintf(file, "[");
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            const auto& record = records[i];
+            fprintf(file, "%s\n{\"iteration\":%llu,\"thread\":%d,\"phase\":\"%s\",\"peer\":%d,\"beginNs\":%lld,\"endNs\":%lld}", (i > 0) ? "," : "",
+                    (unsigned long long)record.m_iteration, (int)record.m_thread, AggregationPhaseName(record.m_phase), record.m_peer, record.m_beginNs, record.m_endNs);
+        }
+
+        fprintf(file, "\n]\n");
+    }
+
+    // Drops all held records.
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& buffer : m_buffers)
+            buffer->m_numRecorded.store(0, std::memory_order_release);
+    }
+
+private:
+    AggregationProfiler()
+        : m_enabled(false), m_iteration(0), m_samplingPeriod(1), m_clockOffsetNs(0), m_ringCapacity(16384), m_epoch(Clock::now())
+    {}
+
+    DISABLE_COPY_AND_MOVE(AggregationProfiler);
+
+    ThreadBuffer& CurrentThreadBuffer()
+    {
+        static thread_local ThreadBuffer* threadBuffer = nullptr;
+        if (threadBuffer == nullptr)
+        {
+            // Buffers are owned by the profiler and outlive their threads, so records of finished threads remain available.
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer(m_buffers.size(), m_ringCapacity)));
+            threadBuffer = m_buffers.back().get();
+        }
+
+        return *threadBuffer;
+    }
+
+    std::atomic<bool> m_enabled;
+    std::atomic<size_t> m_iteration;
+    std::atomic<size_t> m_samplingPeriod;
+    std::atomic<long long> m_clockOffsetNs;
+    size_t m_ringCapacity;
+    const Clock::time_point m_epoch;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+// Records the time between construction and destruction as the given phase.
+class ScopedAggregationPhase
+{
+public:
+    explicit ScopedAggregationPhase(AggregationPhase phase, int peer = -1)
+        : m_phase(phase), m_peer(peer), m_active(AggregationProfiler::Get().IsEnabled()), m_beginNs(m_active ? AggregationProfiler::Get().Now() : 0)
+    {}
+
+    ~ScopedAggregationPhase()
+    {
+        if (m_active)
+            AggregationProfiler::Get().Record(m_phase, m_peer, m_beginNs, AggregationProfiler::Get().Now());
+    }
+
+    DISABLE_COPY_AND_MOVE(ScopedAggregationPhase);
+
+private:
+    AggregationPhase m_phase;
+    int m_peer;
+    bool m_active;
+    long long m_beginNs;
+};
+
+} } }
@@ -0,0 +1,130 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "MPIWrapper.h"
+#include "MPITransfer.h"
+#include "AggregationProfiler.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// AggregationTracer -- timeline of the aggregation phases of all ranks in the
+// Chrome trace event format (chrome://tracing, Perfetto).
+// Tracing is built on the AggregationProfiler records: every rank is a process,
+// every recording thread a thread of it, and peer specific phases carry the peer
+// rank as an argument. The clocks of all ranks are restarted right after a barrier,
+// so their timestamps are comparable up to the skew with which the ranks leave the
+// barrier and the drift of the clocks since; they are not synchronized otherwise.
+// Start and WriteMergedTrace are collective and must be called by all ranks while
+// no aggregation is in flight.
+// =======================================================================
+
+class AggregationTracer
+{
+public:
+    // Starts recording every 'samplingPeriod'-th aggregation. 'barrier' synchronizes all ranks.
+    template <class Barrier>
+    static void Start(const Barrier& barrier, size_t samplingPeriod)
+    {
+        AggregationProfiler& profiler = AggregationProfiler::Get();
+        profiler.SetSamplingPeriod(samplingPeriod);
+        profiler.Clear();
+
+        barrier();
+        profiler.RestartClock();
+        profiler.Enable(true);
+    }
+
+    static void Start(MPIWrapper& mpi, size_t samplingPeriod)
+    {
+        Start([&mpi] { mpi.WaitAll(); }, samplingPeriod);
+    }
+
+    // Trace events of the records held by this rank, as a comma separated list of JSON objects.
+    static std::string FormatEvents(int rank)
+    {
+        std::string events;
+        char buffer[512];
+        sprintf(buffer, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"rank %d\"}}", rank, rank);
+        events += buffer;
+
+        for (const auto& record : AggregationProfiler::Get().Snapshot())
+        {
+            sprintf(buffer, ",\n{\"name\":\"%s\",\"cat\":\"aggregation\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"iteration\":%llu,\"peer\":%d}}",
+                    AggregationPhaseName(record.m_phase), record.m_beginNs * 1e-3, (record.m_endNs - record.m_beginNs) * 1e-3,
+                    rank, (int)record.m_thread, (unsigned long long)record.m_iteration, record.m_peer);
+            events += buffer;
+        }
+
+        return events;
+    }
+
+    // Writes the events of all ranks into a single trace file.
+    static void WriteTrace(const std::wstring& path, const std::vector<std::string>& eventsPerRank)
+    {
+        FILE* file = _wfopen(path.c_str(), L"w");
+        if (file == nullptr)
+            RuntimeError("Failed to open aggregation trace file '%ls' for writing.", path.c_str());
+
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        for (size_t i = 0; i < eventsPerRank.size(); ++i)
+            fprintf(file, "%s%s", (i > 0) ? ",\n" : "", eventsPerRank[i].c_str());
+
+        fprintf(file, "\n]}\n");
+        fclose(file);
+    }
+
+    // Collects the events of all ranks on the main node, which writes them to 'path'.
+    static void WriteMergedTrace(MPIWrapper& mpi, const std::wstring& path)
+    {
+        std::string events = FormatEvents((int)mpi.CurrentNodeRank());
+        if (!mpi.IsMainNode())
+        {
+            unsigned long long length = events.size();
+            MPI_Request request;
+            mpi.Isend(&length, (int)sizeof(length), MPI_CHAR, (int)mpi.MainNodeRank(), TraceMessageTag, &request) || MpiFail("MPI_Isend");
+            mpi.Wait(&request, MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+
+            std::vector<MPI_Request> requests;
+            if (length > 0)
+                IsendChunked(mpi, events.data(), events.size(), (int)mpi.MainNodeRank(), TraceMessageTag, requests);
+            mpi.Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+            return;
+        }
+
+        std::vector<std::string> eventsPerRank(mpi.NumNodesInUse());
+        eventsPerRank[mpi.CurrentNodeRank()] = std::move(events);
+        for (size_t rank = 0; rank < mpi.NumNodesInUse(); ++rank)
+        {
+            if (rank == mpi.CurrentNodeRank())
+                continue;
+
+            unsigned long long length = 0;
+            MPI_Request request;
+            mpi.Irecv(&length, (int)sizeof(length), MPI_CHAR, (int)rank, TraceMessageTag, &request) || MpiFail("MPI_Irecv");
+            mpi.Wait(&request, MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+
+            eventsPerRank[rank].resize((size_t)length);
+            std::vector<MPI_Request> requests;
+            if (length > 0)
+                IrecvChunked(mpi, &eventsPerRank[rank][0], (size_t)length, (int)rank, TraceMessageTag, requests);
+            mpi.Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        }
+
+        WriteTrace(path, eventsPerRank);
+    }
+
+private:
+    // Reserved tag, see MPITransfer.h.
+    static const int TraceMessageTag = FirstReservedMessageTag + 7;
+};
+
+} } }
@@ -10,7 +10,12 @@
 #include "QuantizedMatrix.h"
 #include "MatrixQuantizer.h"
 #include "MatrixQuantizerGPU.h"
-#include <future>
+#include "MPITransfer.h"
+#include "FlatDistGradHeader.h"
+#include "AsyncAggregationEngine.h"
+#include "AggregationProfiler.h"
+#include "AggregationTrace.h"
+#include "PeerArrivalStatistics.h"
 #include "TimerUtility.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -37,18 +42,37 @@ class AllReduceDistGradAggregator : public IDistGradAggregator<ElemType>
     static const int DEBUG_OUTPUT_TRACE_LEVEL = 3;
 
 public:
-    AllReduceDistGradAggregator(const std::shared_ptr<MPIWrapper>& mpi, int nBits, bool zeroThresholdFor1Bit, bool useQuantizationForSelfStripe, bool useAsyncAggregation, int traceLevel, int syncStatsTrace)
+    // With async aggregation, 'asyncAggregationDepth' is the number of aggregations that may be in flight, i.e. the
+    // staleness of the gradients returned by AggregateGradients. 'asyncAggregationCpuCore' optionally pins the
+    // aggregation thread to a CPU core.
+    AllReduceDistGradAggregator(const std::shared_ptr<MPIWrapper>& mpi, int nBits, bool zeroThresholdFor1Bit, bool useQuantizationForSelfStripe, bool useAsyncAggregation, int traceLevel, int syncStatsTrace,
+                                size_t asyncAggregationDepth = 1, int asyncAggregationCpuCore = -1)
         : IDistGradAggregator<ElemType>(mpi), m_numQuantizationBits(nBits), m_zeroThresholdFor1Bit(zeroThresholdFor1Bit), m_useQuantizationForSelfStripe(useQuantizationForSelfStripe),
-        m_traceLevel(traceLevel), m_initialized(false), m_useAsyncAggregation(useAsyncAggregation), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0)
-    {}
+        m_traceLevel(traceLevel), m_initialized(false), m_useAsyncAggregation(useAsyncAggregation), m_asyncAggregationDepth(asyncAggregationDepth), m_asyncAggregationCpuCore(asyncAggregationCpuCore),
+        m_nextBufferedGradientSet(0), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0)
+    {
+        if (m_useAsyncAggregation && (m_asyncAggregationDepth == 0))
+            InvalidArgument("AllReduceDistGradAggregator: the async aggregation depth must be at least 1.");
+
+        // The sync perf stats include a breakdown of the aggregation phases
+        if (m_syncStatsTrace > 0)
+            AggregationProfiler::Get().Enable(true);
+
+        // Report persistent stragglers at most once a minute
+        if (m_traceLevel > 0)
+            m_arrivalStatistics.SetLogInterval(60);
+    }
 
     ~AllReduceDistGradAggregator()
     {
-        for (size_t i = 0; i < m_recvHeaders.size(); ++i)
-            DistGradHeader::Destroy(m_recvHeaders[i]);
+        // Let the in-flight aggregations finish before their buffers go away
+        m_asyncAggregationEngine.reset();
 
-        if (m_bufferedGradHeader != nullptr)
-            DistGradHeader::Destroy(m_bufferedGradHeader);
+        for (auto& bufferedGradientSet : m_bufferedGradientSets)
+        {
+            if (bufferedGradientSet.m_header != nullptr)
+                DistGradHeader::Destroy(bufferedGradientSet.m_header);
+        }
     }
 
     // Gets the range of columns to be processed by the node with the specified rank
@@ -101,30 +125,53 @@ public:
 
                 m_aggGradStripeQuantizers.push_back(std::unique_ptr<MatrixQuantizer<ElemType>>(currAggGradQuantizer));
                 m_recvGradStripesQuantized.push_back(std::move(currRecvGradStripesQuantized));
-
-                if (m_useAsyncAggregation)
-                    m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
             }
 
             if (m_useAsyncAggregation)
             {
-                m_bufferedGradHeader = DistGradHeader::Create(numEvalNodes);
-                m_bufferedGradHeader->Clear();
-            }
+                // One set of buffered gradients per aggregation in flight, indexed by the position of the gradient
+                m_bufferedGradientSets.resize(m_asyncAggregationDepth);
+                for (auto& bufferedGradientSet : m_bufferedGradientSets)
+                {
+                    for (size_t i = 0; i < gradients.size(); i++)
+                    {
+                        bufferedGradientSet.m_gradients.push_back(std::unique_ptr<Matrix<ElemType>>(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId)));
+                        bufferedGradientSet.m_gradientPtrs.push_back(bufferedGradientSet.m_gradients.back().get());
+                    }
 
-            if (m_mpi->IsMainNode())
-            {
-                for (size_t i = 0; i < NumProc() - 1; ++i)
-                    m_recvHeaders.push_back(DistGradHeader::Create(numEvalNodes));
+                    bufferedGradientSet.m_header = DistGradHeader::Create(numEvalNodes);
+                    bufferedGradientSet.m_header->Clear();
+                }
+
+                m_asyncAggregationEngine.reset(new AsyncAggregationEngine([this, deviceId](size_t slot)
+                {
+                    BufferedGradientSet& bufferedGradientSet = m_bufferedGradientSets[slot];
+
+                    // We are on the aggregation thread. Make sure it is setup to use the right device
+                    Matrix<ElemType>::SetDevice(deviceId);
+
+                    // Synchronize the Quantization compute stream with the completion of
+                    // compute of the gradient matrices on the main compute stream
+                    bufferedGradientSet.m_mainStreamSyncEvent->SynchronizeQuantizationComputeStreamWithEvent<ElemType>();
+                    bufferedGradientSet.m_mainStreamSyncEvent.reset();
+
+                    AggregateGradientsImpl(bufferedGradientSet.m_gradientPtrs, bufferedGradientSet.m_header, bufferedGradientSet.m_showSyncPerfStats);
+                }, m_asyncAggregationDepth, m_asyncAggregationCpuCore));
             }
+
+            // The header is reduced as a flat vector of doubles
+            m_headerBuffer.resize(FlatDistGradHeader::NumElements(numEvalNodes));
         }
         else if (resetState)
         {
             // If we are resetting state, let's clear previous quantization residues
 
             // Make sure there is no pending async aggregation
-            if (m_useAsyncAggregation && m_pendingAsyncAggregation.valid())
-                LogicError("Unexpected pending async gradient aggregation found when resetting aggregator state!");
+            for (const auto& bufferedGradientSet : m_bufferedGradientSets)
+            {
+                if (bufferedGradientSet.m_pending)
+                    LogicError("Unexpected pending async gradient aggregation found when resetting aggregator state!");
+            }
 
             for (size_t i = 0; i < m_preAggGradQuantizers.size(); ++i)
                 m_preAggGradQuantizers[i]->ResetResidue();
@@ -136,12 +183,12 @@ public:
             }
 
             // Zero out the buffered gradients if resetting state
-            if (m_useAsyncAggregation)
+            for (auto& bufferedGradientSet : m_bufferedGradientSets)
             {
-                for (size_t i = 0; i < gradients.size(); i++)
-                    m_bufferedGradients[gradients[i]]->SetValue(0);
+                for (auto& bufferedGradient : bufferedGradientSet.m_gradients)
+                    bufferedGradient->SetValue(0);
 
-                m_bufferedGradHeader->Clear();
+                bufferedGradientSet.m_header->Clear();
             }
         }
     }
@@ -155,16 +202,19 @@ public:
 
         if (m_useAsyncAggregation)
         {
-            // If we are performing async gradient aggregation, let's wait for the pending gradient aggregation to finish
-            // then swap the contents of the buffered gradients and the new gradient matrices and fire an async aggreagation
-            // of the new gradient matrices
-            if (m_pendingAsyncAggregation.valid())
+            // If we are performing async gradient aggregation, let's wait for the oldest pending gradient aggregation to finish
+            // then swap the contents of its buffered gradients and the new gradient matrices and queue an async aggregation
+            // of the new gradient matrices. With a depth of D, the returned gradients are D iterations old.
+            BufferedGradientSet& bufferedGradientSet = m_bufferedGradientSets[m_nextBufferedGradientSet];
+            m_nextBufferedGradientSet = (m_nextBufferedGradientSet + 1) % m_bufferedGradientSets.size();
+            if (bufferedGradientSet.m_pending)
             {
                 Timer aggregationTimer;
                 if (showSyncPerfStats)
                     aggregationTimer.Start();
 
-                m_pendingAsyncAggregation.get();
+                bufferedGradientSet.m_pending = false;
+                m_asyncAggregationEngine->Wait(bufferedGradientSet.m_ticket);
 
                 if (showSyncPerfStats)
                 {
@@ -174,11 +224,13 @@ public:
                 }
             }
 
-            std::vector<Matrix<ElemType>*> newGradients;
             size_t numGradMatrices = gradients.size();
+            if (numGradMatrices != bufferedGradientSet.m_gradients.size())
+                LogicError("No buffered gradient matrix found corresponding to a gradient matrix to be aggregated!");
+
             for (size_t i = 0; i < numGradMatrices; i++)
             {
-                Matrix<ElemType>* bufferedGradientMatrix = m_bufferedGradients[gradients[i]].get();
+                Matrix<ElemType>* bufferedGradientMatrix = bufferedGradientSet.m_gradientPtrs[i];
                 if ((bufferedGradientMatrix == nullptr) ||
                     (bufferedGradientMatrix->GetNumCols() != gradients[i]->GetNumCols()) ||
                     (bufferedGradientMatrix->GetNumRows() != gradients[i]->GetNumRows()) ||
@@ -189,38 +241,25 @@ public:
 
                 // Swap the gradient matrix contents with the buffered matrices
                 std::swap(*(gradients[i]), *bufferedGradientMatrix);
-
-                newGradients.push_back(bufferedGradientMatrix);
             }
 
             // Swap the grad header contents with the buffered grad header
-            swap(*headerCPU, *m_bufferedGradHeader);
+            swap(*headerCPU, *bufferedGradientSet.m_header);
 
             // Initiate aggregation only if any samples were processed in previous iteration
             if (resetState || (headerCPU->numSamples != 0))
             {
                 int deviceId = gradients[0]->GetDeviceId();
-                DistGradHeader* newGradHeader = m_bufferedGradHeader;
 
                 // Since we will be aggregating the gradients asynchronously, let us
                 // ensure that the gradient matrices have been computed before starting to aggregate
                 // them asynchronously on another thread. This essentially means that when we are using
                 // a GPU device, we will synchronize on the main GPU compute stream before starting
                 // the gradient aggregation asynchronously on a separate stream
-                MatrixComputeStreamEvent* mainStreamSyncEvent = MatrixComputeStreamEvent::Create(deviceId);
-
-                m_pendingAsyncAggregation = std::async(std::launch::async, [=] {
-                    // We are starting on a new thread. Make sure the new thread is
-                    // setup to use the right device
-                    Matrix<ElemType>::SetDevice(deviceId);
-
-                    // Synchronize the Quantization compute stream with the completion of
-                    // compute of the gradient matrices on the main compute stream
-                    mainStreamSyncEvent->SynchronizeQuantizationComputeStreamWithEvent<ElemType>();
-                    delete mainStreamSyncEvent;
-
-                    AggregateGradientsImpl(newGradients, newGradHeader, showSyncPerfStats);
-                });
+                bufferedGradientSet.m_mainStreamSyncEvent.reset(MatrixComputeStreamEvent::Create(deviceId));
+                bufferedGradientSet.m_showSyncPerfStats = showSyncPerfStats;
+                bufferedGradientSet.m_ticket = m_asyncAggregationEngine->Submit(&bufferedGradientSet - m_bufferedGradientSets.data());
+                bufferedGradientSet.m_pending = true;
 
                 return true;
             }
@@ -236,6 +275,10 @@ public:
 
     void AggregateGradientsImpl(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
     {
+        AggregationProfiler& profiler = AggregationProfiler::Get();
+        size_t profilerIteration = profiler.BeginIteration();
+        long long aggregationBeginNs = profiler.Now();
+
         Timer aggregationTimer;
         int deviceId = gradients[0]->GetDeviceId();
         if (showSyncPerfStats)
@@ -299,9 +342,24 @@ public:
             m_preAggGradQuantizers[i]->QuantizeAsync(*(gradients[i]), *(m_gradQuantized[i]), m_zeroThresholdFor1Bit);
         }
 
-        // Initiate receive of the stripe to be aggregated by the current node, from all other nodes
+        // Reduce the header across all nodes with a nonblocking allreduce that proceeds during the stripe exchange,
+        // instead of gathering the headers on the main node and sending the aggregate back from there
+        m_headerBuffer.resize(FlatDistGradHeader::NumElements(headerCPU->numEvalNode));
+        FlatDistGradHeader::Flatten(*headerCPU, m_headerBuffer.data());
+
+        MPI_Request headerRequest;
+        long long headerBeginNs = profiler.Now();
+        m_mpi->Iallreduce(MPI_IN_PLACE, m_headerBuffer.data(), (int)m_headerBuffer.size(), MPI_DOUBLE, MPI_SUM, &headerRequest) || MpiFail("MPI_Iallreduce");
+
+        // Message ids of the different transfers; MessageTag maps them into the range of tags supported by MPI.
+        const size_t stripeMessageId = 0;
+        const size_t aggregatedStripeMessageId = numGradMatrices;
+
+        // Initiate receive of the stripe to be aggregated by the current node, from all other nodes.
+        // Stripes larger than MaxMessageChunkBytes arrive in several chunks, each with its own request.
         std::vector<MPI_Request> recvGradStripesQuantizedRequests;
         std::vector<int> recvRequestIdxToGradientMatrixIdxMap;
+        std::vector<size_t> recvRequestIdxToStripeIdxMap;
         for (size_t i = 0; i < numGradMatrices; ++i)
         {
             Stripe stripe = GetStripeForNode(gradients[i]->GetNumCols(), MyRank(), NumProc());
@@ -312,32 +370,26 @@ public:
                 {
                     int source = (j >= MyRank()) ? (j + 1) : j;
 
-                    recvGradStripesQuantizedRequests.push_back(MPI_Request());
-                    int recvRequestIdx = recvGradStripesQuantizedRequests.size() - 1;
-
-                    m_mpi->Irecv(m_recvGradStripesQuantized[i][j]->Buffer(), m_recvGradStripesQuantized[i][j]->GetSize(), MPI_CHAR, source, i, &(recvGradStripesQuantizedRequests[recvRequestIdx])) || MpiFail("MPI_Irecv");
+                    IrecvChunked(*m_mpi, m_recvGradStripesQuantized[i][j]->Buffer(), m_recvGradStripesQuantized[i][j]->GetSize(), source, MessageTag(stripeMessageId + i), recvGradStripesQuantizedRequests);
+                    recvRequestIdxToStripeIdxMap.resize(recvGradStripesQuantizedRequests.size(), (recvRequestIdxToGradientMatrixIdxMap.size() - 1) * (NumProc() - 1) + j);
                 }
             }
         }
 
-        // Initiate receive of the header on the main node
-        std::vector<MPI_Request> recvHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
-        {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
-            {
-                int source = (j >= MyRank()) ? (j + 1) : j;
-                // We use a tag of 'numGradMatrices' for the pre-aggregation header
-                m_mpi->Irecv(m_recvHeaders[j], m_recvHeaders[j]->Size(), MPI_CHAR, source, numGradMatrices, &(recvHeaderRequests[j])) || MpiFail("MPI_Irecv");
-            }
-        }
+        // Number of chunks still outstanding per received stripe.
+        std::vector<size_t> recvStripeChunksPending(recvRequestIdxToGradientMatrixIdxMap.size() * (NumProc() - 1), 0);
+        for (size_t stripeIdx : recvRequestIdxToStripeIdxMap)
+            recvStripeChunksPending[stripeIdx]++;
 
         // Asynchronously send stripes of the quantized gradient matrices to the respective nodes that own aggregation of that stripe
         std::vector<std::vector<MPI_Request>> sendGradStripesQuantizedRequests(numGradMatrices);
         for (size_t i = 0; i < numGradMatrices; ++i)
         {
-            m_preAggGradQuantizers[i]->WaitQuantizeAsyncDone();
-            size_t sendRequestIdx = 0;
+            {
+                ScopedAggregationPhase quantizePhase(AggregationPhase::Quantize);
+                m_preAggGradQuantizers[i]->WaitQuantizeAsyncDone();
+            }
+
             for (size_t j = 0; j < NumProc(); ++j)
             {
                 Stripe stripe = GetStripeForNode(gradients[i]->GetNumCols(), j, NumProc());
@@ -346,7 +398,6 @@ public:
                     // Do not send stripe for self
                     if (j != MyRank())
                     {
-                        sendGradStripesQuantizedRequests[i].push_back(MPI_Request());
                         QuantizedMatrix<ElemType> quantizedStripe = m_gradQuantized[i]->ColumnSlice(stripe.m_startCol, stripe.m_numCols);
                         if (m_traceLevel >= DEBUG_OUTPUT_TRACE_LEVEL)
                         {
@@ -360,8 +411,8 @@ public:
                             quantizedStripe.Print(printHeaderBuf, 0, numRowsToPrint - 1, 0, numColsToPrint - 1);
                         }
 
-                        m_mpi->Isend(quantizedStripe.Buffer(), quantizedStripe.GetSize(), MPI_CHAR, j, i, &(sendGradStripesQuantizedRequests[i][sendRequestIdx])) || MpiFail("MPI_Isend");
-                        sendRequestIdx++;
+                        ScopedAggregationPhase sendPhase(AggregationPhase::SendPost, (int)j);
+                        IsendChunked(*m_mpi, quantizedStripe.Buffer(), quantizedStripe.GetSize(), (int)j, MessageTag(stripeMessageId + i), sendGradStripesQuantizedRequests[i]);
                     }
                     else
                     {
@@ -377,31 +428,51 @@ public:
             }
         }
 
-        // Send the headers from all nodes but the main node
-        MPI_Request sendHeaderRequest;
-        if (!m_mpi->IsMainNode())
-            m_mpi->Isend(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices, &sendHeaderRequest) || MpiFail("MPI_Isend");
-
         // Wait for the stripes to arrive from each node and unquantize and aggregate
         size_t numReceivesExpected = recvGradStripesQuantizedRequests.size();
         size_t numActualReceives = 0;
         std::vector<int> perGradMatrixReceiveCount(recvRequestIdxToGradientMatrixIdxMap.size(), 0);
+        long long exchangeBeginNs = profiler.Now();
+        m_arrivalStatistics.BeginRound(NumProc());
+        std::vector<int> completedRequests(recvGradStripesQuantizedRequests.size());
+        size_t numCompletedRequests = 0;
+        size_t nextCompletedRequest = 0;
+        PeerArrivalStatistics::Clock::time_point completionTime;
         while (numActualReceives < numReceivesExpected)
         {
-            int idx = MPI_UNDEFINED;
-            m_mpi->Waitany(recvGradStripesQuantizedRequests.size(), recvGradStripesQuantizedRequests.data(), &idx, MPI_STATUS_IGNORE) || MpiFail("MPI_Waitany");
-            if (idx == MPI_UNDEFINED)
+            // All receives that completed by now are taken at once, so that they arrive at the time MPI reports
+            // them complete, rather than after the stripes processed before them have been unquantized.
+            if (nextCompletedRequest == numCompletedRequests)
             {
-                break;
+                int numCompleted = MPI_UNDEFINED;
+                MPI_Waitsome((int)recvGradStripesQuantizedRequests.size(), recvGradStripesQuantizedRequests.data(), &numCompleted, completedRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitsome");
+                if (numCompleted == MPI_UNDEFINED)
+                {
+                    break;
+                }
+
+                completionTime = PeerArrivalStatistics::Clock::now();
+                numCompletedRequests = (size_t)numCompleted;
+                nextCompletedRequest = 0;
             }
 
+            int idx = completedRequests[nextCompletedRequest++];
             numActualReceives++;
 
-            int gradMatrixIdxPosition = idx / (NumProc() - 1);
-            int recvBufferSubIndex = idx % (NumProc() - 1);
+            // Only process the stripe once all of its chunks have arrived
+            size_t stripeIdx = recvRequestIdxToStripeIdxMap[idx];
+            if (--recvStripeChunksPending[stripeIdx] > 0)
+                continue;
+
+            int gradMatrixIdxPosition = (int)(stripeIdx / (NumProc() - 1));
+            int recvBufferSubIndex = (int)(stripeIdx % (NumProc() - 1));
             // Map idx back to the actual gradient matrix index
             int gradMatrixIdx = recvRequestIdxToGradientMatrixIdxMap[gradMatrixIdxPosition];
 
+            int source = (recvBufferSubIndex >= (int)MyRank()) ? (recvBufferSubIndex + 1) : recvBufferSubIndex;
+            m_arrivalStatistics.RecordArrival(source, completionTime);
+            profiler.Record(AggregationPhase::StripeArrival, source, exchangeBeginNs, profiler.Timestamp(completionTime));
+
             // Wait for the previous Unquantize to finish before issuing a new one
             if (m_useQuantizationForSelfStripe || (perGradMatrixReceiveCount[gradMatrixIdxPosition] > 0))
                 m_aggGradStripeQuantizers[gradMatrixIdx]->WaitUnquantizeAsyncDone();
@@ -418,7 +489,13 @@ public:
                 m_recvGradStripesQuantized[gradMatrixIdx][recvBufferSubIndex]->Print(printHeaderBuf, 0, numRowsToPrint - 1, 0, numColsToPrint - 1);
             }
 
-            m_aggGradStripeQuantizers[gradMatrixIdx]->UnquantizeAsync(*(m_recvGradStripesQuantized[gradMatrixIdx][recvBufferSubIndex]), *(aggGradStripes[gradMatrixIdx]), true);
+            {
+                // When profiling, wait for the unquantization, so that the phase covers it rather than just issuing it.
+                ScopedAggregationPhase unquantizePhase(AggregationPhase::UnquantizeAccumulate, source);
+                m_aggGradStripeQuantizers[gradMatrixIdx]->UnquantizeAsync(*(m_recvGradStripesQuantized[gradMatrixIdx][recvBufferSubIndex]), *(aggGradStripes[gradMatrixIdx]), true);
+                if (profiler.IsEnabled())
+                    m_aggGradStripeQuantizers[gradMatrixIdx]->WaitUnquantizeAsyncDone();
+            }
 
             perGradMatrixReceiveCount[gradMatrixIdxPosition]++;
 
@@ -436,31 +513,12 @@ public:
         }
 
         assert(numActualReceives == numReceivesExpected);
-
-        // On the main node wait for the headers to arrive and aggregate
-        if (m_mpi->IsMainNode())
-        {
-            size_t numNodesHeadersReceivedFrom = 0;
-            while (numNodesHeadersReceivedFrom < (NumProc() - 1))
-            {
-                int idx = MPI_UNDEFINED;
-                m_mpi->Waitany(recvHeaderRequests.size(), recvHeaderRequests.data(), &idx, MPI_STATUS_IGNORE) || MpiFail("MPI_Waitany");
-                if (idx == MPI_UNDEFINED)
-                    break;
-
-                numNodesHeadersReceivedFrom++;
-
-                headerCPU->Aggregate(m_recvHeaders[idx], true);
-            }
-
-            assert(numNodesHeadersReceivedFrom == (NumProc() - 1));
-        }
+        m_arrivalStatistics.EndRound();
 
         std::vector<std::vector<MPI_Request>> recvAggGradStripesQuantizedRequests(numGradMatrices);
         // Initiate receive of stripes of quantized aggregated gradients from different nodes
         for (size_t i = 0; i < numGradMatrices; ++i)
         {
-            size_t recvRequestIdx = 0;
             for (size_t j = 0; j < NumProc(); ++j)
             {
                 // Do not recv stripe for self
@@ -469,20 +527,13 @@ public:
                     Stripe stripe = GetStripeForNode(gradients[i]->GetNumCols(), j, NumProc());
                     if (stripe.m_numCols > 0)
                     {
-                        recvAggGradStripesQuantizedRequests[i].push_back(MPI_Request());
                         QuantizedMatrix<ElemType> quantizedStripe = m_gradQuantized[i]->ColumnSlice(stripe.m_startCol, stripe.m_numCols);
-                        m_mpi->Irecv(quantizedStripe.Buffer(), quantizedStripe.GetSize(), MPI_CHAR, j, numGradMatrices + 1 + i, &(recvAggGradStripesQuantizedRequests[i][recvRequestIdx])) || MpiFail("MPI_Irecv");
-                        recvRequestIdx++;
+                        IrecvChunked(*m_mpi, quantizedStripe.Buffer(), quantizedStripe.GetSize(), (int)j, MessageTag(aggregatedStripeMessageId + i), recvAggGradStripesQuantizedRequests[i]);
                     }
                 }
             }
         }
 
-        MPI_Request recvAggHeaderRequest;
-        // Initiate receive of the aggregate header
-        if (!m_mpi->IsMainNode())
-            m_mpi->Irecv(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices + 1 + numGradMatrices, &recvAggHeaderRequest) || MpiFail("MPI_Irecv");
-
         // Initiate broadcast of quantized aggregated gradient stripes to all other nodes
         std::vector<std::vector<MPI_Request>> sendAggGradStripeQuantizedRequests(numGradMatrices);
         for (size_t i = 0; i < numGradMatrices; ++i)
@@ -490,42 +541,39 @@ public:
             Stripe stripe = GetStripeForNode(gradients[i]->GetNumCols(), MyRank(), NumProc());
             if (stripe.m_numCols > 0)
             {
-                sendAggGradStripeQuantizedRequests[i] = std::vector<MPI_Request>(NumProc() - 1);
-                m_aggGradStripeQuantizers[i]->WaitQuantizeAsyncDone();
+                {
+                    ScopedAggregationPhase requantizePhase(AggregationPhase::Requantize);
+                    m_aggGradStripeQuantizers[i]->WaitQuantizeAsyncDone();
+                }
+
                 for (size_t j = 0; j < NumProc() - 1; ++j)
                 {
                     int dest = (j >= MyRank()) ? (j + 1) : j;
                     // TODO: Should we use MPI_Bcast instead for better performance
-                    m_mpi->Isend(aggGradStripesQuantized[i]->Buffer(), aggGradStripesQuantized[i]->GetSize(), MPI_CHAR, dest, numGradMatrices + 1 + i, &(sendAggGradStripeQuantizedRequests[i][j])) || MpiFail("MPI_Irecv");
+                    IsendChunked(*m_mpi, aggGradStripesQuantized[i]->Buffer(), aggGradStripesQuantized[i]->GetSize(), dest, MessageTag(aggregatedStripeMessageId + i), sendAggGradStripeQuantizedRequests[i]);
                 }
             }
         }
 
-        // Initiate send of the aggregate header from main node
-        std::vector<MPI_Request> sendAggHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
-        {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
-            {
-                int dest = (j >= MyRank()) ? (j + 1) : j;
-                // TODO: Should we use MPI_Bcast instead for better performance
-                m_mpi->Isend(headerCPU, headerCPU->Size(), MPI_CHAR, dest, numGradMatrices + 1 + numGradMatrices, &(sendAggHeaderRequests[j])) || MpiFail("MPI_Isend");
-            }
-        }
-
         // Wait to receive all aggregated stripes and unquantize
         for (size_t i = 0; i < numGradMatrices; ++i)
         {
-            m_mpi->Waitall(recvAggGradStripesQuantizedRequests[i].size(), recvAggGradStripesQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+            {
+                ScopedAggregationPhase allgatherPhase(AggregationPhase::Allgather);
+                m_mpi->Waitall(recvAggGradStripesQuantizedRequests[i].size(), recvAggGradStripesQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+            }
 
             m_preAggGradQuantizers[i]->UnquantizeAsync(*(m_gradQuantized[i]), *(gradients[i]), false);
         }
 
-        // Wait to receive aggregate header
-        if (!m_mpi->IsMainNode())
-            m_mpi->Wait(&recvAggHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        // Wait for the aggregate header and copy it back
+        m_mpi->Wait(&headerRequest, MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+        profiler.Record(AggregationPhase::Header, -1, headerBeginNs, profiler.Now());
+
+        FlatDistGradHeader::Unflatten(m_headerBuffer.data(), *headerCPU);
 
         // Wait for all the unquantizations to finish
+        long long finalUnquantizeBeginNs = profiler.Now();
         for (size_t i = 0; i < numGradMatrices; ++i)
         {
             m_preAggGradQuantizers[i]->WaitUnquantizeAsyncDone();
@@ -538,6 +586,8 @@ public:
             }
         }
 
+        profiler.Record(AggregationPhase::FinalUnquantize, -1, finalUnquantizeBeginNs, profiler.Now());
+
         // Wait for completion of the async send requests
         for (int i = 0; i < sendGradStripesQuantizedRequests.size(); ++i)
         {
@@ -545,26 +595,43 @@ public:
                 m_mpi->Waitall(sendGradStripesQuantizedRequests[i].size(), sendGradStripesQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
         }
 
-        if (!m_mpi->IsMainNode())
-            m_mpi->Wait(&sendHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-
         for (int i = 0; i < sendAggGradStripeQuantizedRequests.size(); ++i)
         {
             if (sendAggGradStripeQuantizedRequests[i].size() > 0)
                 m_mpi->Waitall(sendAggGradStripeQuantizedRequests[i].size(), sendAggGradStripeQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
         }
 
-        if (m_mpi->IsMainNode())
-            m_mpi->Waitall(sendAggHeaderRequests.size(), sendAggHeaderRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        profiler.Record(AggregationPhase::Total, -1, aggregationBeginNs, profiler.Now());
 
         if (showSyncPerfStats)
         {
             aggregationTimer.Stop();
             double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
             fprintf(stderr, "Actual gradient aggregation time: %.6g\n", gradientAggregationTime);
+            profiler.PrintSummary(stderr, profilerIteration);
         }
     }
 
+    // Per-peer arrival skew of the stripe exchanges, used to spot stragglers
+    PeerArrivalStatistics& ArrivalStatistics()
+    {
+        return m_arrivalStatistics;
+    }
+
+    // Starts recording every 'samplingPeriod'-th aggregation for a timeline trace of all nodes.
+    // Collective; has to be called while no (async) aggregation is in flight.
+    void StartAggregationTrace(size_t samplingPeriod)
+    {
+        AggregationTracer::Start(*m_mpi, samplingPeriod);
+    }
+
+    // Collects the recorded phases of all nodes and writes them as a Chrome trace on the main node.
+    // Collective; has to be called while no (async) aggregation is in flight.
+    void WriteAggregationTrace(const std::wstring& path)
+    {
+        AggregationTracer::WriteMergedTrace(*m_mpi, path);
+    }
+
     // Debug helper to print matrix contents
     static void PrintMatrix(const char* printHeader, Matrix<ElemType>* matrixToPrint, bool peek = true)
     {
@@ -594,7 +661,12 @@ private:
 
     std::vector<std::unique_ptr<MatrixQuantizer<ElemType>>> m_aggGradStripeQuantizers;
     std::vector<std::vector<std::unique_ptr<QuantizedMatrix<ElemType>>>> m_recvGradStripesQuantized;
-    std::vector<DistGradHeader*> m_recvHeaders;
+
+    // Per-peer arrival skew of the stripe exchanges
+    PeerArrivalStatistics m_arrivalStatistics;
+
+    // Flattened header, see FlatDistGradHeader
+    std::vector<double> m_headerBuffer;
 
     // Number of bits that each gradient value is quantized to before communication
     // with other nodes
@@ -612,12 +684,30 @@ private:
     // Perform asynchronous gradient aggregation using double buffering of the gradient matrices
     bool m_useAsyncAggregation;
 
-    // Future corresponding to the current in-flight async gradient aggregation
-    std::future<void> m_pendingAsyncAggregation;
+    // Number of async aggregations that may be in flight at the same time
+    size_t m_asyncAggregationDepth;
+
+    // CPU core the aggregation thread is pinned to, negative for no pinning
+    int m_asyncAggregationCpuCore;
+
+    // Buffered gradients and header of one async aggregation, gradients are indexed by their position
+    struct BufferedGradientSet
+    {
+        std::vector<std::unique_ptr<Matrix<ElemType>>> m_gradients;
+        std::vector<Matrix<ElemType>*> m_gradientPtrs;
+        DistGradHeader* m_header = nullptr;
+        std::unique_ptr<MatrixComputeStreamEvent> m_mainStreamSyncEvent;
+        bool m_showSyncPerfStats = false;
+        bool m_pending = false;
+        size_t m_ticket = 0;
+    };
+
+    // Ring of buffered gradient sets that we asynchronously aggregate
+    std::vector<BufferedGradientSet> m_bufferedGradientSets;
+    size_t m_nextBufferedGradientSet;
 
-    // Buffered gradients that we asynchronously aggregate
-    std::unordered_map<Matrix<ElemType>*, std::unique_ptr<Matrix<ElemType>>> m_bufferedGradients;
-    DistGradHeader* m_bufferedGradHeader;
+    // Persistent thread running the async aggregations
+    std::unique_ptr<AsyncAggregationEngine> m_asyncAggregationEngine;
 
     int m_traceLevel;
     int m_syncStatsTrace;
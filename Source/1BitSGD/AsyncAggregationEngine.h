@@ -0,0 +1,225 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <vector>
+#include <map>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// SingleProducerSingleConsumerQueue -- bounded lock-free ring buffer.
+// Exactly one thread may push and exactly one (other) thread may pop.
+// =======================================================================
+
+template <class T>
+class SingleProducerSingleConsumerQueue
+{
+public:
+    explicit SingleProducerSingleConsumerQueue(size_t capacity)
+        : m_items(capacity + 1), m_head(0), m_tail(0)
+    {}
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(SingleProducerSingleConsumerQueue);
+
+    // Called by the producer; returns false if the queue is full.
+    bool TryPush(const T& item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = Next(tail);
+        if (next == m_head.load(std::memory_order_acquire))
+            return false;
+
+        m_items[tail] = item;
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Called by the consumer; returns false if the queue is empty.
+    bool TryPop(T& item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        item = m_items[head];
+        m_head.store(Next(head), std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    size_t Next(size_t index) const
+    {
+        return (index + 1) % m_items.size();
+    }
+
+    std::vector<T> m_items;
+    std::atomic<size_t> m_head;
+    std::atomic<size_t> m_tail;
+};
+
+// =======================================================================
+// AsyncAggregationEngine -- persistent worker thread executing aggregation jobs.
+// Jobs are identified by a slot index handed to the job handler and are executed
+// one at a time in submission order, so jobs may share quantizers and MPI state.
+// Submit returns a ticket that can be waited for; the worker sleeps while there
+// is no work. An error raised by a job is rethrown by the Wait for its ticket.
+// =======================================================================
+
+class AsyncAggregationEngine
+{
+public:
+    typedef std::function<void(size_t)> JobHandler;
+
+    // 'maxJobsInFlight' bounds the number of submitted but not yet waited for jobs.
+    // If 'cpuCore' is non-negative the worker thread is pinned to that core.
+    AsyncAggregationEngine(JobHandler handler, size_t maxJobsInFlight, int cpuCore = -1)
+        : m_handler(std::move(handler)), m_queue(maxJobsInFlight), m_numSubmitted(0), m_numCompleted(0), m_stop(false)
+    {
+        m_thread = std::thread([this] { Run(); });
+        if (cpuCore >= 0)
+            PinToCore(m_thread, cpuCore);
+    }
+
+    // Finishes all submitted jobs before returning, so that no transfer is left half done.
+    ~AsyncAggregationEngine()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_workAvailable.notify_one();
+        m_thread.join();
+    }
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(AsyncAggregationEngine);
+
+    // Queues a job for the given slot and returns its ticket.
+    size_t Submit(size_t slot)
+    {
+        if (!m_queue.TryPush(slot))
+            LogicError("AsyncAggregationEngine: too many aggregations in flight.");
+
+        {
+            // Taking the lock orders the push with the predicate check of a worker about to sleep.
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+
+        m_workAvailable.notify_one();
+        return m_numSubmitted++;
+    }
+
+    // Blocks until the job with the given ticket has completed, and rethrows the error raised by it, if any.
+    void Wait(size_t ticket)
+    {
+        if (m_numCompleted.load(std::memory_order_acquire) <= ticket)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobCompleted.wait(lock, [this, ticket] { return m_numCompleted.load(std::memory_order_acquire) > ticket; });
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto error = m_errors.find(ticket);
+        if (error != m_errors.end())
+        {
+            std::exception_ptr exception = error->second;
+            m_errors.erase(error);
+            std::rethrow_exception(exception);
+        }
+    }
+
+private:
+    void Run()
+    {
+        for (;;)
+        {
+            size_t slot;
+            if (!m_queue.TryPop(slot))
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workAvailable.wait(lock, [this] { return m_stop || !m_queue.Empty(); });
+                if (m_queue.Empty())
+                    return;
+
+                continue;
+            }
+
+            std::exception_ptr error;
+            try
+            {
+                m_handler(slot);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                // Jobs complete in submission order, so the ticket of this job is the number completed before it.
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (error)
+                    m_errors[m_numCompleted.load(std::memory_order_relaxed)] = error;
+
+                m_numCompleted.fetch_add(1, std::memory_order_release);
+            }
+
+            m_jobCompleted.notify_all();
+        }
+    }
+
+    static void PinToCore(std::thread& thread, int cpuCore)
+    {
+#ifdef _WIN32
+        if (SetThreadAffinityMask(thread.native_handle(), (DWORD_PTR)1 << cpuCore) == 0)
+            fprintf(stderr, "WARNING: Failed to pin the gradient aggregation thread to core %d.\n", cpuCore);
+#else
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpuCore, &cpuSet);
+        if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet), &cpuSet) != 0)
+            fprintf(stderr, "WARNING: Failed to pin the gradient aggregation thread to core %d.\n", cpuCore);
+#endif
+    }
+
+    JobHandler m_handler;
+    SingleProducerSingleConsumerQueue<size_t> m_queue;
+
+    // m_numSubmitted is only touched by the submitting thread.
+    size_t m_numSubmitted;
+    std::atomic<size_t> m_numCompleted;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_jobCompleted;
+    bool m_stop;
+
+    // Errors of completed jobs that have not been waited for yet, by ticket.
+    std::map<size_t, std::exception_ptr> m_errors;
+};
+
+} } }
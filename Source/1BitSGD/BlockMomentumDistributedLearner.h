@@ -8,12 +8,105 @@
 #include <vector>
 #include "CNTKLibrary.h"
 #include "DistributedLearnerBase.h"
+#include "MPITransfer.h"
+#include "AggregationProfiler.h"
+#include "AggregationTrace.h"
+#include "AsyncAggregationEngine.h"
+#include "AdaptiveSyncPeriod.h"
+#include "HostGroupExchange.h"
+#include "GossipExchange.h"
+#include "ShardExchange.h"
 #include <numeric>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
 namespace CNTK
 {
+    ///
+    /// Synchronization schedule of a single parameter of the block momentum trainer.
+    ///
+    struct BlockMomentumParameterSchedule
+    {
+        // The parameter is aggregated every this many blocks.
+        size_t syncEveryBlocks = 1;
+
+        // Block momentum time constant of the parameter, in the units of the learner's; 0 uses the learner's.
+        double blockMomentumAsTimeConstant = 0;
+    };
+
+    ///
+    /// Additional options of the block momentum trainer.
+    ///
+    struct BlockMomentumAdditionalOptions
+    {
+        // Aggregate the block gradient in the background while the next block is trained locally.
+        // The aggregated update is applied at the next synchronization point, on top of the local
+        // progress made in the meantime, i.e. the block update is delayed by one block.
+        bool useAsyncAggregation = false;
+
+        // Exchange the block gradients quantized, through QuantizedDistributedCommunicator::QuantizedAggregateInPlace.
+        // The quantization error is kept in residuals and carried over to the next block.
+        bool useQuantizedAggregation = false;
+
+        // Keep only this worker's 1/N shard of the smoothed gradient, and compute the block gradient in place in the
+        // parameters instead of a separate buffer. The block gradients are reduce-scattered to the owners of the shards,
+        // each worker applies the block update to its shard, and the updated shards are allgathered; this costs the
+        // traffic of a single aggregation. Not combinable with async or quantized aggregation.
+        bool useLeanState = false;
+
+        // With useLeanState, keep the smoothed gradient shard in 16 bits. The conversion is done in software on the
+        // host, so this is only supported for parameters on the CPU; the learner rejects it for parameters on a GPU.
+        bool useHalfPrecisionSmoothedGradient = false;
+
+        // If non-zero, synchronize the model in groups of consecutive parameters of about this many bytes: the block
+        // gradient of a group is aggregated in the background while the block gradient of the next group is computed
+        // and the previous group is updated. Not combinable with async, quantized or lean aggregation.
+        size_t pipelinedAggregationGroupBytes = 0;
+
+        // If non-zero, adapt the number of samples per worker between synchronizations such that the time spent
+        // synchronizing is about this fraction of the time spent training locally. The period stays within
+        // [minSyncPeriodPerWorker, maxSyncPeriodPerWorker], which default to 1/4 and 4 times the initial period.
+        // The block momentum time constant is kept, so the block momentum follows the period.
+        double adaptiveSyncTargetRatio = 0;
+        size_t minSyncPeriodPerWorker = 0;
+        size_t maxSyncPeriodPerWorker = 0;
+
+        // If non-zero, the models of the workers on a host are averaged this many times per block, and only one
+        // leader worker per host takes part in the block momentum update across hosts, whose result it broadcasts
+        // to the other workers of its host. Not combinable with async, quantized, lean or pipelined aggregation, nor with
+        // an adaptive sync period.
+        size_t hostAveragingsPerBlock = 0;
+
+        // If not None, replace the global block update by gossip averaging: at every synchronization each worker
+        // averages its models at the previous and at this synchronization with those of a peer chosen by the topology,
+        // and applies block momentum to the averaged block gradient. Checkpoints and shutdown average the models exactly.
+        // Not combinable with the other modes.
+        Microsoft::MSR::CNTK::GossipTopology gossipTopology = Microsoft::MSR::CNTK::GossipTopology::None;
+
+        // Sum the training loss and evaluation criterion of every block over the workers as part of the control word
+        // exchanged at every synchronization, instead of agreeing on and running a separate aggregation. A progress
+        // summary reports the metrics of the blocks synchronized since the previous summary; the minibatches since the
+        // last synchronization are reported with the next one. Only without a synchronization since the previous
+        // summary do the workers agree on an exchange of the metrics.
+        bool piggybackMetrics = false;
+
+        // If non-zero, a parameter is only aggregated if on some worker the norm of its block gradient exceeds this
+        // fraction of the norm of the parameter. The block gradients of skipped parameters accumulate until they are
+        // aggregated. Workers agree on the parameters to aggregate through the synchronization control word.
+        // Not combinable with the other modes.
+        double significanceThreshold = 0;
+
+        // Schedules of parameters, by parameter name; parameters not listed are aggregated every block with the learner's
+        // time constant. Parameters aggregated every k > 1 blocks are spread over the k phases such that about the same
+        // number of bytes is aggregated at every block. Checkpoints and shutdown aggregate all parameters.
+        // Not combinable with async, quantized, lean, pipelined, hierarchical or gossip aggregation.
+        std::map<std::wstring, BlockMomentumParameterSchedule> parameterSchedules;
+    };
+
     ///
     /// Block Momentum Trainer.
     ///
@@ -56,7 +149,8 @@ namespace CNTK
             size_t globalModelAggregationBlockSize,
             bool useNesterovMomentum,
             bool resetSGDMomentumAfterAggregation,
-            double blockLearningRate)
+            double blockLearningRate,
+            const BlockMomentumAdditionalOptions& additionalOptions = BlockMomentumAdditionalOptions())
             : BlockMomentumDistributedLearner(
                   communicator,
                   learner,
@@ -65,7 +159,8 @@ namespace CNTK
                   useNesterovMomentum,
                   resetSGDMomentumAfterAggregation,
                   blockLearningRate,
-                  Momentum2TimeConstant(1.0 - 1.0 / (double)communicator->Workers().size(), globalModelAggregationBlockSize))
+                  Momentum2TimeConstant(1.0 - 1.0 / (double)communicator->Workers().size(), globalModelAggregationBlockSize),
+                  additionalOptions)
         {}
 
         BlockMomentumDistributedLearner(
@@ -76,7 +171,8 @@ namespace CNTK
             bool useNesterovMomentum,
             bool resetSGDMomentumAfterAggregation,
             double blockLearningRate,
-            double blockMomentumAsTimeConstant)
+            double blockMomentumAsTimeConstant,
+            const BlockMomentumAdditionalOptions& additionalOptions = BlockMomentumAdditionalOptions())
             : DistributedLearnerBase(communicator, learner, distributedAfterSamples),
             m_useNesterovMomentum(useNesterovMomentum),
             m_resetSGDMomentumAfterAggregation(resetSGDMomentumAfterAggregation),
@@ -86,11 +182,86 @@ namespace CNTK
             m_numSamplesSeenInCurrentBlock(0),
             m_endOfDataReached(false),
             m_localTotalNumSamplesSeen(0),
-            m_syncPeriodPerWorker(globalModelAggregationBlockSize / communicator->Workers().size())
+            m_syncPeriodPerWorker(globalModelAggregationBlockSize / communicator->Workers().size()),
+            m_useAsyncAggregation(additionalOptions.useAsyncAggregation),
+            m_quantizedCommunicator(additionalOptions.useQuantizedAggregation ? dynamic_cast<QuantizedDistributedCommunicator*>(communicator.get()) : nullptr),
+            m_useLeanState(additionalOptions.useLeanState),
+            m_useHalfPrecisionSmoothedGradient(additionalOptions.useHalfPrecisionSmoothedGradient),
+            m_pipelinedAggregationGroupBytes(additionalOptions.pipelinedAggregationGroupBytes),
+            m_piggybackMetrics(additionalOptions.piggybackMetrics),
+            m_significanceThreshold(additionalOptions.significanceThreshold)
         {
             if (m_syncPeriodPerWorker == 0)
                 InvalidArgument("Sync period is too small.");
 
+            if (additionalOptions.useQuantizedAggregation && !m_quantizedCommunicator)
+                InvalidArgument("Quantized block gradient aggregation requires a quantized distributed communicator.");
+
+            if (m_useLeanState && (m_useAsyncAggregation || m_quantizedCommunicator))
+                InvalidArgument("Lean block momentum state cannot be combined with async or quantized block gradient aggregation.");
+
+            if (m_useHalfPrecisionSmoothedGradient && !m_useLeanState)
+                InvalidArgument("16-bit smoothed gradients require lean block momentum state.");
+
+            if (m_useLeanState)
+            {
+                m_mpi = Microsoft::MSR::CNTK::MPIWrapper::GetInstance();
+                m_shardExchange.reset(new Microsoft::MSR::CNTK::ShardExchange(*m_mpi));
+            }
+
+            if (m_pipelinedAggregationGroupBytes > 0 && (m_useAsyncAggregation || m_quantizedCommunicator || m_useLeanState))
+                InvalidArgument("Pipelined block gradient aggregation cannot be combined with async, quantized or lean aggregation.");
+
+            if (m_significanceThreshold > 0 &&
+                (m_useAsyncAggregation || m_quantizedCommunicator || m_useLeanState || m_pipelinedAggregationGroupBytes > 0 ||
+                 additionalOptions.hostAveragingsPerBlock > 0 || additionalOptions.gossipTopology != Microsoft::MSR::CNTK::GossipTopology::None))
+                InvalidArgument("Significance filtered block aggregation cannot be combined with async, quantized, lean, pipelined, hierarchical or gossip aggregation.");
+
+            if (!additionalOptions.parameterSchedules.empty() &&
+                (m_useAsyncAggregation || m_quantizedCommunicator || m_useLeanState || m_pipelinedAggregationGroupBytes > 0 ||
+                 additionalOptions.hostAveragingsPerBlock > 0 || additionalOptions.gossipTopology != Microsoft::MSR::CNTK::GossipTopology::None))
+                InvalidArgument("Per parameter block momentum schedules cannot be combined with async, quantized, lean, pipelined, hierarchical or gossip aggregation.");
+
+            if (additionalOptions.hostAveragingsPerBlock > 0)
+            {
+                if (m_useAsyncAggregation || m_quantizedCommunicator || m_useLeanState || m_pipelinedAggregationGroupBytes > 0)
+                    InvalidArgument("Hierarchical block momentum cannot be combined with async, quantized, lean or pipelined aggregation.");
+
+                std::vector<std::wstring> hostOfRank(communicator->Workers().size());
+                for (const auto& worker : communicator->Workers())
+                    hostOfRank[worker.m_globalRank] = worker.m_hostId;
+
+                // The sync period is the period of host averaging from here on.
+                m_hostAveragingsPerBlock = additionalOptions.hostAveragingsPerBlock;
+                m_syncPeriodPerWorker = std::max<size_t>(m_syncPeriodPerWorker / m_hostAveragingsPerBlock, 1);
+                m_mpi = Microsoft::MSR::CNTK::MPIWrapper::GetInstance();
+                m_hostGroupExchange.reset(new Microsoft::MSR::CNTK::HostGroupExchange(*m_mpi, hostOfRank));
+            }
+
+            if (additionalOptions.gossipTopology != Microsoft::MSR::CNTK::GossipTopology::None)
+            {
+                if (m_useAsyncAggregation || m_quantizedCommunicator || m_useLeanState || m_pipelinedAggregationGroupBytes > 0 || m_hostGroupExchange)
+                    InvalidArgument("Gossip averaging cannot be combined with async, quantized, lean, pipelined or hierarchical aggregation.");
+
+                m_mpi = Microsoft::MSR::CNTK::MPIWrapper::GetInstance();
+                m_gossipExchange.reset(new Microsoft::MSR::CNTK::GossipExchange(*m_mpi, additionalOptions.gossipTopology));
+            }
+
+            if (additionalOptions.adaptiveSyncTargetRatio > 0)
+            {
+                // The period of host averaging is not the block period whose cost the controller balances.
+                if (m_hostGroupExchange)
+                    InvalidArgument("An adaptive sync period cannot be combined with hierarchical block momentum.");
+
+                size_t minSyncPeriod = additionalOptions.minSyncPeriodPerWorker > 0 ? additionalOptions.minSyncPeriodPerWorker : std::max<size_t>(m_syncPeriodPerWorker / 4, 1);
+                size_t maxSyncPeriod = additionalOptions.maxSyncPeriodPerWorker > 0 ? additionalOptions.maxSyncPeriodPerWorker : m_syncPeriodPerWorker * 4;
+                if (minSyncPeriod > maxSyncPeriod)
+                    InvalidArgument("Minimum sync period (%d) is larger than the maximum sync period (%d).", (int)minSyncPeriod, (int)maxSyncPeriod);
+
+                m_syncPeriodController.reset(new Microsoft::MSR::CNTK::AdaptiveSyncPeriodController(additionalOptions.adaptiveSyncTargetRatio, minSyncPeriod, maxSyncPeriod));
+                m_syncPeriodPerWorker = m_syncPeriodController->Clamp(m_syncPeriodPerWorker);
+            }
+
             // Need to allocate memory here to make sure not hitting OOM
             std::vector<NDArrayViewPtr> parameterValues;
             GetParameterValues(learner->Parameters(), parameterValues);
@@ -98,7 +269,43 @@ namespace CNTK
             m_blockLevelSmoothedGradient.resize(parameterValues.size());
             m_prevParameters.resize(parameterValues.size());
             m_tempBlockGradient.resize(parameterValues.size());
+            m_asyncLaunchParameters.resize(parameterValues.size());
+            m_halfSmoothedGradients.resize(parameterValues.size());
             Reset(parameterValues);
+
+            // With significance filtering the control word is followed by a count per parameter of the workers it is significant on.
+            if (m_significanceThreshold > 0)
+                m_parameterSignificant.assign(parameterValues.size(), true);
+
+            if (!additionalOptions.parameterSchedules.empty())
+                BuildParameterSchedule(learner->Parameters(), parameterValues, additionalOptions.parameterSchedules);
+
+            if (FiltersParameters())
+                m_samplesSinceParameterSync.assign(parameterValues.size(), 0);
+
+            m_controlWord = std::make_shared<NDArrayView>(DataType::Double, NDShape{ ControlWordSize + m_parameterSignificant.size() }, DeviceDescriptor::CPUDevice());
+            m_controlWordBuffer.push_back(m_controlWord);
+
+            for (auto& blockGradient : m_tempBlockGradient)
+            {
+                if (!blockGradient)
+                    continue;
+
+                if (blockGradient->GetDataType() == DataType::Double)
+                    SplitForAggregation<double>(blockGradient, m_tempBlockGradientChunks);
+                else
+                    SplitForAggregation<float>(blockGradient, m_tempBlockGradientChunks);
+            }
+
+            if (m_useAsyncAggregation)
+                m_asyncAggregationEngine.reset(new Microsoft::MSR::CNTK::AsyncAggregationEngine([this](size_t) { RunAsyncAggregation(); }, 1));
+
+            if (m_pipelinedAggregationGroupBytes > 0)
+            {
+                BuildPipelineGroups();
+                // At most the group being aggregated and the group following it are in flight.
+                m_pipelineAggregationEngine.reset(new Microsoft::MSR::CNTK::AsyncAggregationEngine([this](size_t group) { RunPipelinedAggregation(group); }, 2));
+            }
         }
 
         size_t MinibatchSizeScaleFactor() override
@@ -123,6 +330,12 @@ namespace CNTK
             // and this order is to make sure all workers got the same model after block update
             if (!info.IsEmpty())
             {
+                if (m_piggybackMetrics)
+                {
+                    AccumulateMetric(info.trainingLossValue, m_blockMetricSums[0]);
+                    AccumulateMetric(info.evalCriterionValue, m_blockMetricSums[1]);
+                }
+
                 // For block momentum the number of aggreagate/checkpoints should match, so for now we ignore the return value of local learners.
                 auto profWeights = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainWeights);
                 m_learner->Update(gradientValues, info.numberOfSamples, info.atEndOfSweep);
@@ -161,12 +374,17 @@ namespace CNTK
 
             DebugPrintSynchronizeInfo(Action::Checkpoint, action);
 
-            // Always aggregate before the checkpoint, so prevParameter and m_numSamplesSeenInCurrentBlock don't need to be saved
-            SynchronizeAction(Action::Aggregate);
-            AggregateImpl(values);
-            
+            // Always aggregate before the checkpoint, so prevParameter and m_numSamplesSeenInCurrentBlock don't need to be saved.
+            // The aggregation is synchronous, so that no aggregation is left in flight, and covers all parameters.
+            SynchronizeAction(Action::Aggregate, /*allowSkipping=*/false);
+            AggregateImpl(values, /*synchronous=*/true);
+
+            // Resetting the residuals of the quantized block gradients, since they are not checkpointed.
+            ResetQuantizationResiduals();
+
+            // With lean state the smoothed gradients are assembled from the shards of all workers.
             std::vector<DictionaryValue> serializedSmoothedGradients;
-            for (auto sg : m_blockLevelSmoothedGradient)
+            for (auto sg : m_useLeanState ? GatherSmoothedGradients(values) : m_blockLevelSmoothedGradient)
             {
                 serializedSmoothedGradients.push_back(*sg);
             }
@@ -174,6 +392,7 @@ namespace CNTK
             Dictionary result;
             result[L"base"] = DistributedLearnerBase::CreateCheckpoint();
             result[L"localTotalNumSamplesSeen"] = m_localTotalNumSamplesSeen;
+            result[L"syncPeriodPerWorker"] = m_syncPeriodPerWorker;
             result[L"blockLevelSmoothedGradient"] = serializedSmoothedGradients;
             return result;
         }
@@ -182,6 +401,9 @@ namespace CNTK
         {
             DistributedLearnerBase::RestoreFromCheckpoint(checkpoint[L"base"].Value<Dictionary>());
             m_localTotalNumSamplesSeen = checkpoint[L"localTotalNumSamplesSeen"].Value<size_t>();
+            // The adapted sync period; checkpoints written without it keep the configured one.
+            if (m_syncPeriodController && checkpoint.Contains(L"syncPeriodPerWorker"))
+                m_syncPeriodPerWorker = m_syncPeriodController->Clamp(checkpoint[L"syncPeriodPerWorker"].Value<size_t>());
             const auto& smoothedGradients = checkpoint[L"blockLevelSmoothedGradient"].Value<std::vector<DictionaryValue>>();
 
             if (m_blockLevelSmoothedGradient.size() != smoothedGradients.size())
@@ -189,12 +411,72 @@ namespace CNTK
 
             for (size_t i = 0; i < m_blockLevelSmoothedGradient.size(); i++)
             {
-                m_blockLevelSmoothedGradient[i]->CopyFrom(smoothedGradients[i].Value<NDArrayView>());
+                const auto& smoothedGradient = smoothedGradients[i].Value<NDArrayView>();
+                if (!m_useLeanState)
+                    m_blockLevelSmoothedGradient[i]->CopyFrom(smoothedGradient);
+                else if (smoothedGradient.GetDataType() == DataType::Double)
+                    RestoreSmoothedGradientShard<double>(i, smoothedGradient);
+                else
+                    RestoreSmoothedGradientShard<float>(i, smoothedGradient);
             }
 
+            // An aggregation still in flight belongs to the state we are replacing.
+            FinishAsyncAggregation();
+
+            // The residuals of the quantized block gradients are not checkpointed, and belong to the replaced state as well.
+            ResetQuantizationResiduals();
+
+            // Timing smoothed before the restore does not describe the restored run.
+            if (m_syncPeriodController)
+                m_syncPeriodController->Reset();
+
+            m_blockMetricSums[0] = m_blockMetricSums[1] = nullptr;
+            m_aggregatedMetrics[0] = m_aggregatedMetrics[1] = 0;
+            m_hasAggregatedMetrics = false;
+
+            m_hasBlockTiming = false;
+            m_asyncWaitSeconds = 0;
+            m_hostAveragingsInCurrentBlock = 0;
+            m_hierarchicalBlockSamples = 0;
+            m_gossipRound = 0;
+            m_blockIndex = 0;
+            std::fill(m_samplesSinceParameterSync.begin(), m_samplesSinceParameterSync.end(), 0);
             m_prevParamInitialized = false;
         }
 
+        // Starts recording every 'samplingPeriod'-th model aggregation for a timeline trace.
+        // Has to be called by all workers between aggregations.
+        void StartAggregationTrace(size_t samplingPeriod)
+        {
+            WaitForAsyncAggregation();
+            Microsoft::MSR::CNTK::AggregationTracer::Start([this] { m_communicator->Barrier(); }, samplingPeriod);
+        }
+
+        // Collects the recorded phases of all workers and writes them as a Chrome trace on the main worker.
+        // Has to be called by all workers between aggregations.
+        void WriteAggregationTrace(const std::wstring& path)
+        {
+            WaitForAsyncAggregation();
+            std::string events = Microsoft::MSR::CNTK::AggregationTracer::FormatEvents((int)m_communicator->CurrentWorker().m_globalRank);
+
+            Dictionary input;
+            input[L"events"] = std::wstring(events.begin(), events.end());
+
+            std::vector<DictionaryPtr> output;
+            m_communicator->Gather(input, output, m_communicator->Workers());
+            if (!m_communicator->CurrentWorker().IsMain())
+                return;
+
+            std::vector<std::string> eventsPerRank;
+            for (const auto& workerEvents : output)
+            {
+                const auto& value = (*workerEvents)[L"events"].Value<std::wstring>();
+                eventsPerRank.push_back(std::string(value.begin(), value.end()));
+            }
+
+            Microsoft::MSR::CNTK::AggregationTracer::WriteTrace(path, eventsPerRank);
+        }
+
     private:
         // Block momentum needs to do aggregation of loss and eval across workers.
         virtual void DoAggregateMetricsIfNeeded(NDArrayViewPtr& localTrainingLoss, NDArrayViewPtr& localEvalCriterion) override
@@ -206,31 +488,14 @@ namespace CNTK
                 return;
             }
 
-            Action action;
-            while ((action = SynchronizeAction(Action::AggregateMetrics)) != Action::AggregateMetrics)
+            if (m_piggybackMetrics)
             {
-                DebugPrintSynchronizeInfo(Action::AggregateMetrics, action);
-
-                std::vector<NDArrayViewPtr> paramValues;
-                GetParameterValues(m_learner->Parameters(), paramValues);
-
-                switch (action)
-                {
-                    // Aggregate params first and try for aggregate metrics again
-                    case Action::Aggregate:                        
-                        AggregateImpl(paramValues);
-                        break;
-                    // Can't do checkpointing here since not called from checkpointing code, so return. Checkpointing will be called again eventually.
-                    case Action::Checkpoint:
-                        return;
-                    // Can't aggregate metrics since others are going in shutdown. 
-                    case Action::Shutdown:
-                        m_shutDownSeenBefore = true;
-                        return; // Can't aggregate if another worker is in shutdown mode
-                }
+                PiggybackMetrics(localTrainingLoss, localEvalCriterion);
+                return;
             }
 
-            DebugPrintSynchronizeInfo(Action::AggregateMetrics, action);
+            if (!AgreeOnMetricsAggregation())
+                return;
 
             // Synchronization complete - Start the loss and eval aggregation
             float averageTrainingLoss = 0;
@@ -264,6 +529,96 @@ namespace CNTK
             }
         }
 
+        // Agrees with the other workers on aggregating the metrics, aggregating the model first while others ask for it.
+        // Returns false if the metrics can't be aggregated now, or with 'firstExchangeOnly' if the first synchronization
+        // is not a metrics aggregation.
+        bool AgreeOnMetricsAggregation(bool firstExchangeOnly = false)
+        {
+            Action action;
+            while ((action = SynchronizeAction(Action::AggregateMetrics)) != Action::AggregateMetrics)
+            {
+                DebugPrintSynchronizeInfo(Action::AggregateMetrics, action);
+
+                std::vector<NDArrayViewPtr> paramValues;
+                GetParameterValues(m_learner->Parameters(), paramValues);
+
+                switch (action)
+                {
+                    // Aggregate params first and try for aggregate metrics again
+                    case Action::Aggregate:                        
+                        AggregateImpl(paramValues);
+                        break;
+                    // Can't do checkpointing here since not called from checkpointing code, so return. Checkpointing will be called again eventually.
+                    case Action::Checkpoint:
+                        return false;
+                    // Can't aggregate metrics since others are going in shutdown. 
+                    case Action::Shutdown:
+                        m_shutDownSeenBefore = true;
+                        return false; // Can't aggregate if another worker is in shutdown mode
+                }
+
+                if (firstExchangeOnly)
+                    return false;
+            }
+
+            DebugPrintSynchronizeInfo(Action::AggregateMetrics, action);
+            return true;
+        }
+
+        // Reports the metrics of the blocks synchronized since the last report, summed over the workers and averaged like
+        // the negotiated aggregation. Without such a synchronization the workers exchange their metrics first: those in
+        // this state in a single round, while a worker meeting another synchronization takes part in it instead, whose
+        // control word carries the metrics as well. Either way no worker waits for the others to report.
+        void PiggybackMetrics(NDArrayViewPtr& localTrainingLoss, NDArrayViewPtr& localEvalCriterion)
+        {
+            if (!m_hasAggregatedMetrics)
+                AgreeOnMetricsAggregation(/*firstExchangeOnly =*/ true);
+
+            const double numWorkers = static_cast<double>(m_communicator->Workers().size());
+            if (localTrainingLoss)
+                localTrainingLoss->CopyFrom(NDArrayView((float)(m_aggregatedMetrics[0] / numWorkers), NDShape{}, DeviceDescriptor::CPUDevice()));
+
+            if (localEvalCriterion)
+                localEvalCriterion->CopyFrom(NDArrayView((float)(m_aggregatedMetrics[1] / numWorkers), NDShape{}, DeviceDescriptor::CPUDevice()));
+
+            m_aggregatedMetrics[0] = m_aggregatedMetrics[1] = 0;
+            m_hasAggregatedMetrics = false;
+        }
+
+        // Adds the metric of a minibatch to 'sum' on the device of the metric, so that the training loop is not held up by
+        // reading it back to the host; the sum is only read when the next synchronization exchanges it.
+        static void AccumulateMetric(const NDArrayViewPtr& value, NDArrayViewPtr& sum)
+        {
+            if (!value)
+                return;
+
+            if (!sum)
+            {
+                sum = value->DeepClone();
+                return;
+            }
+
+            if (value->GetDataType() == DataType::Double)
+                Matrix<double>::ScaleAndAdd(1.0, *value->GetMatrix<double>(), *sum->GetWritableMatrix<double>());
+            else
+                Matrix<float>::ScaleAndAdd(1.0f, *value->GetMatrix<float>(), *sum->GetWritableMatrix<float>());
+        }
+
+        // Reads a sum of AccumulateMetric back to the host and restarts it.
+        static double TakeMetricSum(const NDArrayViewPtr& sum)
+        {
+            if (!sum)
+                return 0;
+
+            double value = sum->AsScalar<double>();
+            if (sum->GetDataType() == DataType::Double)
+                sum->SetValue(0.0);
+            else
+                sum->SetValue(0.0f);
+
+            return value;
+        }
+
         // Optional override that gets called per minibatch after finishing gradient computation but before updating model parameters
         bool PerformDistributedUpdateIfNeeded(std::vector<NDArrayViewPtr>& parameterValues, MinibatchInfo& info)
         {
@@ -360,59 +715,93 @@ namespace CNTK
             DebugPrintSynchronizeInfo(Action::Shutdown, action);
 
             // Last synchronization
-            AggregateImpl(parameters);
+            AggregateImpl(parameters, /*synchronous=*/true);
             return false; // Make compiler happy.
         }
 
         // Synchronize(Agree) on action before doing it. This is needed to prevent deadlock in MPI. 
         // Aggregate is highest priority. So AggregateImpl can be called after calling SynchronizeAction(Action::Aggreagte). 
         // Others need to ask for permission in a loop
-        Action SynchronizeAction(Action self)
+        // With significance filtering, a worker asking to aggregate proposes to skip its insignificant parameters unless
+        // 'allowSkipping' is false; a parameter is aggregated if any worker does not propose to skip it.
+        Action SynchronizeAction(Action self, bool allowSkipping = true)
         {
             assert(self == Action::Checkpoint || self == Action::Aggregate || self == Action::Shutdown || self == Action::AggregateMetrics);
 
-            double data[2] = { static_cast<double>(self), static_cast<double>(m_localTotalNumSamplesSeen) };
-            auto a = std::make_shared<NDArrayView>(DataType::Double, NDShape{ 2 }, &data, sizeof(double) * 2, DeviceDescriptor::CPUDevice());
-            m_communicator->Concatenate(std::vector<NDArrayViewPtr> { a }, m_actionBuffer, m_communicator->Workers());
-            assert(m_actionBuffer.size() == 1);
+            // The communicator must not be used while a block gradient is aggregated in the background.
+            WaitForAsyncAggregation();
+
+            // A single sum over a preallocated control word: the number of workers requesting each action and the total number of samples seen.
+            double* control = m_controlWord->WritableDataBuffer<double>();
+            std::fill(control, control + ControlWordSize, 0.0);
+            control[static_cast<size_t>(self)] = 1;
+            control[ControlWordSamples] = static_cast<double>(m_localTotalNumSamplesSeen);
+            if (m_syncPeriodController && self == Action::Aggregate && m_hasBlockTiming)
+            {
+                // Workers about to synchronize report the cost of their last synchronization and of the block since.
+                control[ControlWordMeasured] = 1;
+                control[ControlWordSyncSeconds] = m_lastSyncSeconds;
+                control[ControlWordComputeSeconds] = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_blockStartTime).count();
+                control[ControlWordBlockSamples] = static_cast<double>(m_numSamplesSeenInCurrentBlock);
+            }
 
-            auto buffer = m_actionBuffer.front()->DataBuffer<double>();
-            auto bufferSize = m_actionBuffer.front()->Shape().TotalSize();
-            auto bufferEnd = buffer + bufferSize;
+            if (m_significanceThreshold > 0)
+            {
+                double* significance = control + ControlWordSize;
+                if (self == Action::Aggregate && allowSkipping)
+                    EvaluateSignificance(significance);
+                else
+                    std::fill(significance, significance + m_parameterSignificant.size(), 1.0);
+            }
 
-            std::vector<Action> actions;
-            actions.reserve(m_communicator->Workers().size());
+            if (m_piggybackMetrics)
+            {
+                control[ControlWordTrainingLoss] = TakeMetricSum(m_blockMetricSums[0]);
+                control[ControlWordEvalCriterion] = TakeMetricSum(m_blockMetricSums[1]);
+            }
 
-            std::vector<size_t> localNumberOfSamples;
-            localNumberOfSamples.reserve(m_communicator->Workers().size());
+            m_communicator->AggregateInPlace(m_controlWordBuffer, m_communicator->Workers());
 
-            for (const double* start = buffer; start != bufferEnd; start +=2)
+            // Every worker adds the same sums, so all report the same metrics for the same blocks.
+            if (m_piggybackMetrics)
             {
-                actions.push_back(static_cast<Action>((int)*start));
-                localNumberOfSamples.push_back(static_cast<size_t>(*(start + 1)));
+                m_aggregatedMetrics[0] += control[ControlWordTrainingLoss];
+                m_aggregatedMetrics[1] += control[ControlWordEvalCriterion];
+                m_hasAggregatedMetrics = true;
             }
-            m_sampleCount = std::accumulate(localNumberOfSamples.begin(), localNumberOfSamples.end(), (size_t)0);
+
+            m_sampleCount = static_cast<size_t>(control[ControlWordSamples]);
+            for (size_t i = 0; i < m_parameterSignificant.size(); ++i)
+                m_parameterSignificant[i] = (control[ControlWordSize + i] > 0);
+
+            const double numWorkers = static_cast<double>(m_communicator->Workers().size());
+            auto allWant = [control, numWorkers](Action c) { return control[static_cast<size_t>(c)] == numWorkers; };
+            auto anyWants = [control](Action c) { return control[static_cast<size_t>(c)] > 0; };
+
+            // All workers see the same sums, so they all arrive at the same period.
+            if (m_syncPeriodController && control[ControlWordMeasured] == numWorkers)
+                AdaptSyncPeriod(control[ControlWordBlockSamples] / numWorkers, control[ControlWordSyncSeconds] / numWorkers, control[ControlWordComputeSeconds] / numWorkers);
 
             // If all want to aggregate metrics, only then we aggregate metrics.
-            if (std::all_of(actions.begin(), actions.end(), [](Action c) { return c == Action::AggregateMetrics; }))
+            if (allWant(Action::AggregateMetrics))
                 return Action::AggregateMetrics;
 
             // If all want to shutdown - we shutdown.
-            if (std::all_of(actions.begin(), actions.end(), [](Action c) { return c == Action::Shutdown; }))
+            if (allWant(Action::Shutdown))
                 return Action::Shutdown;
 
             // If all want to checkpoint - we checkpoint.
-            if (std::all_of(actions.begin(), actions.end(), [](Action c) { return c == Action::Checkpoint; }))
+            if (allWant(Action::Checkpoint))
                 return Action::Checkpoint;
 
             // If all are either in Checkpoint, Shutdown or AggregateMetrics, 
             //      Then AggregateMetrics state has lowest priority. Workers in it return without doing anything. Other workers wait for Aggregate Metrics to come in their state.
             //      Between Checkpoint and Shutdown, Shutdown has lower priority. Shutdown worker will return and checkpoint worker will wait for others to come in checkpoint state.
-            if (std::all_of(actions.begin(), actions.end(), [](Action c) { return c == Action::Checkpoint || c == Action::Shutdown || c == Action::AggregateMetrics; }))
+            if (!anyWants(Action::Aggregate))
             {
-                bool isAnyCheckpoint = std::any_of(actions.begin(), actions.end(), [](Action c) { return c == Action::Checkpoint; });
-                bool isAnyShutdown = std::any_of(actions.begin(), actions.end(), [](Action c) { return c == Action::Shutdown; });
-                bool isAnyAggregateMetrics = std::any_of(actions.begin(), actions.end(), [](Action c) { return c == Action::AggregateMetrics; });
+                bool isAnyCheckpoint = anyWants(Action::Checkpoint);
+                bool isAnyShutdown = anyWants(Action::Shutdown);
+                bool isAnyAggregateMetrics = anyWants(Action::AggregateMetrics);
                 if (self == Action::Shutdown)
                 {
                     // Do checkpoint first if any other requests checkpoint. Then come back to shutdown.
@@ -456,20 +845,95 @@ namespace CNTK
             return Action::Aggregate;
         }
 
-        void AggregateImpl(std::vector<NDArrayViewPtr>& parameters)
+        // With async aggregation the block gradient is aggregated in the background unless 'synchronous' is set.
+        // Either way, an aggregation still in flight is applied first. All workers have to agree on 'synchronous'.
+        void AggregateImpl(std::vector<NDArrayViewPtr>& parameters, bool synchronous = false)
         {
+            auto syncBeginTime = std::chrono::steady_clock::now();
+            DataType dataType = parameters.front()->GetDataType();
+            if (dataType != DataType::Double && dataType != DataType::Float)
+                RuntimeError("Unsupported type.");
+
+            if (m_asyncAggregationPending)
+            {
+                if (dataType == DataType::Double)
+                    CompleteAsyncAggregation<double>(parameters);
+                else
+                    CompleteAsyncAggregation<float>(parameters);
+            }
+
+            // Every synchronization is one profiler iteration, whichever way it is carried out. It starts after the
+            // aggregation still in flight has been applied, whose records belong to the previous one.
+            Microsoft::MSR::CNTK::AggregationProfiler::Get().BeginIteration();
+
             // Let update the weights.
-            if (parameters.front()->GetDataType() == DataType::Double)
-                SynchronizeModel<double>(parameters);
-            else if (parameters.front()->GetDataType() == DataType::Float)
-                SynchronizeModel<float>(parameters);
+            bool blockCompleted = true;
+            if (m_useAsyncAggregation && !synchronous)
+            {
+                if (dataType == DataType::Double)
+                    LaunchAsyncAggregation<double>(parameters);
+                else
+                    LaunchAsyncAggregation<float>(parameters);
+            }
+            else if (m_gossipExchange && synchronous)
+            {
+                if (dataType == DataType::Double)
+                    AverageModels<double>(parameters);
+                else
+                    AverageModels<float>(parameters);
+            }
+            else if (m_gossipExchange)
+            {
+                if (dataType == DataType::Double)
+                    SynchronizeModelGossip<double>(parameters);
+                else
+                    SynchronizeModelGossip<float>(parameters);
+            }
+            else if (m_hostGroupExchange)
+            {
+                // Checkpoints and shutdown always complete the block, so that all workers end up with the global model.
+                if (dataType == DataType::Double)
+                    blockCompleted = SynchronizeModelHierarchical<double>(parameters, synchronous);
+                else
+                    blockCompleted = SynchronizeModelHierarchical<float>(parameters, synchronous);
+            }
             else
-                RuntimeError("Unsupported type.");
+            {
+                // Checkpoints and shutdown aggregate all parameters, whatever their schedule.
+                m_aggregateAllParameters = synchronous;
+                if (dataType == DataType::Double)
+                    SynchronizeModel<double>(parameters);
+                else
+                    SynchronizeModel<float>(parameters);
+            }
 
             m_numSamplesSeenInCurrentBlock = 0;
 
-            if (m_resetSGDMomentumAfterAggregation)
+            // Host averagings within a block are not block updates, the local momentum carries on through them.
+            if (m_resetSGDMomentumAfterAggregation && blockCompleted)
                 m_learner->ResetSmoothedGradients();
+
+            // With async aggregation, the synchronization costs the launch plus the time the aggregation it
+            // completed was waited for, which is mostly spent before this call while agreeing on the action.
+            m_blockStartTime = std::chrono::steady_clock::now();
+            m_lastSyncSeconds = std::chrono::duration<double>(m_blockStartTime - syncBeginTime).count() + m_asyncWaitSeconds;
+            m_asyncWaitSeconds = 0;
+            m_hasBlockTiming = true;
+        }
+
+        void AdaptSyncPeriod(double blockSamples, double syncSeconds, double computeSeconds)
+        {
+            size_t syncPeriod = m_syncPeriodController->Update(m_syncPeriodPerWorker, blockSamples, syncSeconds, computeSeconds);
+            if (syncPeriod == m_syncPeriodPerWorker)
+                return;
+
+            if (GetTraceLevel() >= TraceLevel::Info && m_communicator->CurrentWorker().IsMain())
+            {
+                fprintf(stderr, "BMUF: sync period per worker %d -> %d samples (sync %.3gs, training %.3gs per block, block momentum %.4f).\n",
+                        (int)m_syncPeriodPerWorker, (int)syncPeriod, syncSeconds, computeSeconds, TimeConstant2Momentum(m_blockMomentumAsTimeConstantPerWorker, syncPeriod));
+            }
+
+            m_syncPeriodPerWorker = syncPeriod;
         }
 
         Dictionary CreateCheckpointImpl(std::vector<NDArrayViewPtr>& parameters)
@@ -503,8 +967,8 @@ namespace CNTK
             {
                 if (m_prevParameters[i]->Shape() != parameters[i]->Shape() ||
                     m_prevParameters[i]->Device() != parameters[i]->Device() ||
-                    m_blockLevelSmoothedGradient[i]->Shape() != parameters[i]->Shape() ||
-                    m_blockLevelSmoothedGradient[i]->Device() != parameters[i]->Device())
+                    (!m_useLeanState && m_blockLevelSmoothedGradient[i]->Shape() != parameters[i]->Shape()) ||
+                    (!m_useLeanState && m_blockLevelSmoothedGradient[i]->Device() != parameters[i]->Device()))
                 {
                     return true;
                 }
@@ -531,7 +995,11 @@ namespace CNTK
         void ResetBuffer(size_t index, const NDArrayViewPtr& p)
         {
             auto data = p->GetMatrix<ElemType>();
-            if (!m_blockLevelSmoothedGradient[index])
+            if (m_useLeanState)
+            {
+                ResetSmoothedGradientShard<ElemType>(index, p);
+            }
+            else if (!m_blockLevelSmoothedGradient[index])
             {
                 // has not been initialized yet
                 auto pSmoothedGrad = std::make_shared<NDArrayView>(AsDataType<ElemType>(), p->Shape(), AsDeviceDescriptor(data->GetDeviceId()));
@@ -551,107 +1019,1155 @@ namespace CNTK
                 m_prevParameters[index]->GetWritableMatrix<ElemType>()->SetValue(*data);
             }
 
-            if (!m_tempBlockGradient[index])
+            // With lean state the block gradient is computed in place in the parameters.
+            if (!m_useLeanState && !m_tempBlockGradient[index])
             {
                 m_tempBlockGradient[index] = std::make_shared<NDArrayView>(AsDataType<ElemType>(), p->Shape(), AsDeviceDescriptor(data->GetDeviceId()));
             }
+
+            if (m_useAsyncAggregation && !m_asyncLaunchParameters[index])
+            {
+                m_asyncLaunchParameters[index] = std::make_shared<NDArrayView>(AsDataType<ElemType>(), p->Shape(), AsDeviceDescriptor(data->GetDeviceId()));
+            }
         }
 
         template<class ElemType>
         void SynchronizeModel(const std::vector<NDArrayViewPtr>& parameterValues)
         {
             ElemType blockMomentum = (ElemType)TimeConstant2Momentum(m_blockMomentumAsTimeConstantPerWorker, m_numSamplesSeenInCurrentBlock);
+            if (m_useLeanState)
+            {
+                SynchronizeModelLean<ElemType>(parameterValues, blockMomentum);
+                return;
+            }
+
+            if (m_pipelineAggregationEngine)
+            {
+                SynchronizeModelPipelined<ElemType>(parameterValues, blockMomentum);
+                return;
+            }
+
+            auto& aggregationProfiler = Microsoft::MSR::CNTK::AggregationProfiler::Get();
+            long long aggregationBeginNs = aggregationProfiler.Now();
 
             // 1. Let's aggregate weights
-            for (size_t i = 0; i < parameterValues.size(); ++i)
+            // With significance filtering the block gradients were computed when agreeing on the parameters to aggregate.
+            for (size_t i = 0; i < parameterValues.size() && !m_blockGradientsComputed; ++i)
             {
+                if (!IsParameterAggregated(i))
+                    continue;
+
                 // Get current model
                 Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();                  // prev model value
                 Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
                 Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
 
-                // Subtract it from the previous model
-                blockGrad = previousWeight - currentWeight; // matW becomes local block gradient (of one worker)
+                // Subtract it from the previous model, directly into the buffer that is sent
+                blockGrad.AssignDifferenceOf(previousWeight, currentWeight); // matW becomes local block gradient (of one worker)
             }
 
+            m_blockGradientsComputed = false;
+
             // Send block gradient over MPI nodes.
-            m_communicator->AggregateInPlace(m_tempBlockGradient, m_communicator->Workers());
+            long long modelAggregationBeginNs = aggregationProfiler.Now();
+            if (FiltersParameters())
+                AggregateSelectedBlockGradients<ElemType>();
+            else
+                AggregateBlockGradients();
+            long long modelUpdateBeginNs = aggregationProfiler.Now();
+            aggregationProfiler.Record(Microsoft::MSR::CNTK::AggregationPhase::ModelAggregation, -1, modelAggregationBeginNs, modelUpdateBeginNs);
 
             // 2. Let's update the model
             for (size_t i = 0; i < parameterValues.size(); ++i)
             {
-                // 2 block gradient aggregation
-                // 2.1. get current model
                 Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();                  // prev model value
                 Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
                 Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
-                // 2.2. model update 
+                Matrix<ElemType>& sg = *m_blockLevelSmoothedGradient[i]->GetWritableMatrix<ElemType>();       // smoothed gradient
+
+                // A skipped parameter keeps its previous weight, so that its block gradient accumulates. Its block momentum
+                // follows the number of samples since it was last aggregated.
+                ElemType parameterMomentum = blockMomentum;
+                if (FiltersParameters())
                 {
-                    Matrix<ElemType>& sg = *m_blockLevelSmoothedGradient[i]->GetWritableMatrix<ElemType>();       // smoothed gradient
-                    // 2.2.1 update block level smoothed gradient; 
-                    // This is essentially a first-order infinite impulse response (IIR) filter with the gain (1 - blockMomentum)*m_blockLearningRate:
-                    // smoothedGradient(t)=blockMomentum * smoothedGradients(t-1) + (1 - blockMomentum)*m_blockLearningRate*blockGrad(t)
-                    Matrix<ElemType>::ScaleAndAdd((ElemType)((1 - blockMomentum)*m_blockLearningRate), blockGrad, (ElemType)blockMomentum, sg);
-                    // 2.2.2 update parameters; 
-                    currentWeight.SetValue(previousWeight);
-                    currentWeight -= sg;
-                    // 2.2.3 Nesterov Momentum 
-                    // A Nesterov momentum here is to do a partial weight update before calculating the gradient, i.e., 
-                    // (step 1) w(t) <-- w(t) - \eta* v(t) 
-                    // (step 2) g(t+1) <-- forwardbackward on minibatches with initial model as w(t)
-                    // (step 3) v(t+1) <-- \eta*v(t) + (1-\eta)*learningRate*g(t+1)
-                    // (step 4) w(t+1) <-- w(t)-v(t)
-                    // (step 5) t      <-- t+1
-                    // without step 1, this becomes stanard momentum
-                    if (m_useNesterovMomentum)
-                    {
-                        Matrix<ElemType>::ScaleAndAdd((ElemType)-blockMomentum, sg, currentWeight);
-                    }
-                    // 2.2.4 update bookkeeping
-                    previousWeight.SetValue(currentWeight);
+                    m_samplesSinceParameterSync[i] += m_numSamplesSeenInCurrentBlock;
+                    if (!IsParameterAggregated(i))
+                        continue;
+
+                    double timeConstant = m_parameterTimeConstants.empty() ? m_blockMomentumAsTimeConstantPerWorker : m_parameterTimeConstants[i];
+                    parameterMomentum = (ElemType)TimeConstant2Momentum(timeConstant, m_samplesSinceParameterSync[i]);
+                    m_samplesSinceParameterSync[i] = 0;
                 }
+
+                if (currentWeight.GetDeviceId() == CPUDEVICE)
+                    UpdateModelCPU(parameterMomentum, blockGrad, sg, previousWeight, currentWeight);
+                else
+                    UpdateModel(parameterMomentum, blockGrad, sg, previousWeight, currentWeight);
             }
-        }
 
-        static double TimeConstant2Momentum(double timeConstant, size_t syncPeroid)
-        {
-            if (timeConstant == 0)
-                return 0;
-            else
-                return exp(-((double)syncPeroid) / timeConstant);
+            m_blockIndex++;
+            m_aggregateAllParameters = false;
+
+            long long aggregationEndNs = aggregationProfiler.Now();
+            aggregationProfiler.Record(Microsoft::MSR::CNTK::AggregationPhase::ModelUpdate, -1, modelUpdateBeginNs, aggregationEndNs);
+            aggregationProfiler.Record(Microsoft::MSR::CNTK::AggregationPhase::Total, -1, aggregationBeginNs, aggregationEndNs);
         }
 
-        static double Momentum2TimeConstant(double bm, size_t syncPeroid)
+        // Starts the aggregation of the block gradient in the background. The weights at this point are kept
+        // to carry the local progress made until the aggregation completes over to the updated model.
+        template<class ElemType>
+        void LaunchAsyncAggregation(const std::vector<NDArrayViewPtr>& parameterValues)
         {
-            if (bm >= 1.0 || bm < 0.0)
+            for (size_t i = 0; i < parameterValues.size(); ++i)
             {
-                InvalidArgument("Unexpected block momentum (%.2f). Block momentum should be in the range of [0,1)\n", bm);
+                Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& launchWeight = *m_asyncLaunchParameters[i]->GetWritableMatrix<ElemType>();
+
+                blockGrad.AssignDifferenceOf(previousWeight, currentWeight);
+                launchWeight.SetValue(currentWeight);
             }
-            return -(double)syncPeroid / log(bm);
+
+            if (parameterValues.empty())
+                return;
+
+            // The aggregation thread waits for the block gradients to be computed on the main compute stream.
+            m_asyncDeviceId = AsCNTKImplDeviceId(parameterValues.front()->Device());
+            m_asyncMainStreamSyncEvent.reset(Microsoft::MSR::CNTK::MatrixComputeStreamEvent::Create(m_asyncDeviceId));
+            m_asyncAggregationBlockSamples = m_numSamplesSeenInCurrentBlock;
+            m_asyncAggregationTicket = m_asyncAggregationEngine->Submit(0);
+            m_asyncAggregationPending = true;
         }
 
-        const bool m_resetSGDMomentumAfterAggregation;
-        const bool m_useNesterovMomentum;
-        const double m_blockLearningRate;
-        const double m_blockMomentumAsTimeConstantPerWorker;
+        // Runs on the aggregation thread.
+        void RunAsyncAggregation()
+        {
+            Matrix<float>::SetDevice(m_asyncDeviceId);
+            m_asyncMainStreamSyncEvent->SynchronizeEvent();
 
-        const size_t m_syncPeriodPerWorker;
-        const size_t m_globalModelAggregationBlockSize;
-        size_t m_numSamplesSeenInCurrentBlock;
-        size_t m_localTotalNumSamplesSeen;
+            Microsoft::MSR::CNTK::ScopedAggregationPhase aggregationPhase(Microsoft::MSR::CNTK::AggregationPhase::ModelAggregation);
+            AggregateBlockGradients();
+        }
 
-        // parameters at the last model aggregation point
-        std::vector<NDArrayViewPtr> m_prevParameters;
-        std::vector<NDArrayViewPtr> m_blockLevelSmoothedGradient;
-        std::vector<NDArrayViewPtr> m_tempBlockGradient;
+        // Pipelined: group g is aggregated in the background while the block gradients of group g + 1 are computed
+        // and group g - 1 is updated, so the synchronization takes about as long as the aggregation alone.
+        template<class ElemType>
+        void SynchronizeModelPipelined(const std::vector<NDArrayViewPtr>& parameterValues, ElemType blockMomentum)
+        {
+            Microsoft::MSR::CNTK::ScopedAggregationPhase totalPhase(Microsoft::MSR::CNTK::AggregationPhase::Total);
+            if (parameterValues.empty())
+                return;
 
-        // temp storage for MPI
-        std::vector<NDArrayViewPtr> m_actionBuffer;
+            m_pipelineDeviceId = AsCNTKImplDeviceId(parameterValues.front()->Device());
+            const size_t numGroups = m_pipelineGroups.size();
+            for (size_t group = 0; group <= numGroups; ++group)
+            {
+                if (group < numGroups)
+                {
+                    for (size_t i = m_pipelineGroups[group].first; i < m_pipelineGroups[group].second; ++i)
+                    {
+                        Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                        Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+                        Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
 
-        bool m_prevParamInitialized = false;
+                        blockGrad.AssignDifferenceOf(previousWeight, currentWeight);
+                    }
 
-        bool m_endOfDataReached;
-        bool m_shutDownSeenBefore = false;
+                    // The aggregation thread waits for the block gradients of the group to be computed on the main compute stream.
+                    m_pipelineEvents[group].reset(Microsoft::MSR::CNTK::MatrixComputeStreamEvent::Create(m_pipelineDeviceId));
+                    m_pipelineTickets[group] = m_pipelineAggregationEngine->Submit(group);
+                }
+
+                if (group > 0)
+                {
+                    m_pipelineAggregationEngine->Wait(m_pipelineTickets[group - 1]);
+
+                    Microsoft::MSR::CNTK::ScopedAggregationPhase updatePhase(Microsoft::MSR::CNTK::AggregationPhase::ModelUpdate);
+                    for (size_t i = m_pipelineGroups[group - 1].first; i < m_pipelineGroups[group - 1].second; ++i)
+                    {
+                        Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                        Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+                        Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
+                        Matrix<ElemType>& sg = *m_blockLevelSmoothedGradient[i]->GetWritableMatrix<ElemType>();
+
+                        if (currentWeight.GetDeviceId() == CPUDEVICE)
+                            UpdateModelCPU(blockMomentum, blockGrad, sg, previousWeight, currentWeight);
+                        else
+                            UpdateModel(blockMomentum, blockGrad, sg, previousWeight, currentWeight);
+                    }
+                }
+            }
+        }
+
+        // Runs on the pipeline aggregation thread. Groups are aggregated in order on all workers.
+        void RunPipelinedAggregation(size_t group)
+        {
+            Matrix<float>::SetDevice(m_pipelineDeviceId);
+            m_pipelineEvents[group]->SynchronizeEvent();
+
+            Microsoft::MSR::CNTK::ScopedAggregationPhase aggregationPhase(Microsoft::MSR::CNTK::AggregationPhase::ModelAggregation);
+            m_communicator->AggregateInPlace(m_pipelineGroupChunks[group], m_communicator->Workers());
+        }
+
+        // Splits the parameters into groups of consecutive parameters of at least m_pipelinedAggregationGroupBytes,
+        // except for the last one. A parameter is never split, so a large parameter makes a group of its own.
+        void BuildPipelineGroups()
+        {
+            size_t groupBytes = 0;
+            for (size_t i = 0; i < m_tempBlockGradient.size(); ++i)
+            {
+                auto& blockGradient = m_tempBlockGradient[i];
+                if (m_pipelineGroups.empty() || groupBytes >= m_pipelinedAggregationGroupBytes)
+                {
+                    m_pipelineGroups.push_back(std::make_pair(i, i));
+                    m_pipelineGroupChunks.emplace_back();
+                    groupBytes = 0;
+                }
+
+                m_pipelineGroups.back().second = i + 1;
+                if (blockGradient->GetDataType() == DataType::Double)
+                {
+                    groupBytes += blockGradient->Shape().TotalSize() * sizeof(double);
+                    SplitForAggregation<double>(blockGradient, m_pipelineGroupChunks.back());
+                }
+                else
+                {
+                    groupBytes += blockGradient->Shape().TotalSize() * sizeof(float);
+                    SplitForAggregation<float>(blockGradient, m_pipelineGroupChunks.back());
+                }
+            }
+
+            m_pipelineEvents.resize(m_pipelineGroups.size());
+            m_pipelineTickets.resize(m_pipelineGroups.size());
+        }
+
+        // Hierarchical: every synchronization averages the models of the workers on a host through the host leader.
+        // Every m_hostAveragingsPerBlock-th one instead sums the block gradients of the host on the leader, the
+        // leaders sum them across hosts and apply the block momentum update, and broadcast the new model within
+        // their host. The sum over all workers is the same as without hierarchy, and so is the block update.
+        // Returns whether the block was completed, i.e. the block momentum update was applied.
+        template<class ElemType>
+        bool SynchronizeModelHierarchical(const std::vector<NDArrayViewPtr>& parameterValues, bool completeBlock)
+        {
+            Microsoft::MSR::CNTK::ScopedAggregationPhase totalPhase(Microsoft::MSR::CNTK::AggregationPhase::Total);
+
+            auto& exchange = *m_hostGroupExchange;
+            m_hierarchicalBlockSamples += m_numSamplesSeenInCurrentBlock;
+            const bool isBlockSync = completeBlock || (++m_hostAveragingsInCurrentBlock >= m_hostAveragingsPerBlock);
+
+            size_t numElements = 0;
+            for (const auto& value : parameterValues)
+                numElements += value->Shape().TotalSize();
+
+            m_hierarchicalBuffer.resize(numElements * sizeof(ElemType));
+            ElemType* buffer = reinterpret_cast<ElemType*>(m_hierarchicalBuffer.data());
+
+            if (!isBlockSync)
+            {
+                Microsoft::MSR::CNTK::ScopedAggregationPhase aggregationPhase(Microsoft::MSR::CNTK::AggregationPhase::ModelAggregation);
+                PackValues<ElemType>(parameterValues, buffer);
+                exchange.SumToLeader(buffer, numElements);
+                if (exchange.IsLeader())
+                {
+                    const ElemType scale = (ElemType)(1.0 / exchange.NumHostRanks());
+                    for (size_t k = 0; k < numElements; ++k)
+                        buffer[k] *= scale;
+                }
+
+                exchange.BroadcastFromLeader(buffer, numElements);
+                UnpackValues<ElemType>(parameterValues, buffer);
+                return false;
+            }
+
+            {
+                Microsoft::MSR::CNTK::ScopedAggregationPhase aggregationPhase(Microsoft::MSR::CNTK::AggregationPhase::ModelAggregation);
+                for (size_t i = 0; i < parameterValues.size(); ++i)
+                {
+                    Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                    Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+                    Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
+
+                    blockGrad.AssignDifferenceOf(previousWeight, currentWeight);
+                }
+
+                PackValues<ElemType>(m_tempBlockGradient, buffer);
+                exchange.SumToLeader(buffer, numElements);
+                if (exchange.IsLeader())
+                    exchange.SumOverLeaders(buffer, numElements);
+            }
+
+            Microsoft::MSR::CNTK::ScopedAggregationPhase updatePhase(Microsoft::MSR::CNTK::AggregationPhase::ModelUpdate);
+            if (exchange.IsLeader())
+            {
+                UnpackValues<ElemType>(m_tempBlockGradient, buffer);
+
+                ElemType blockMomentum = (ElemType)TimeConstant2Momentum(m_blockMomentumAsTimeConstantPerWorker, m_hierarchicalBlockSamples);
+                for (size_t i = 0; i < parameterValues.size(); ++i)
+                {
+                    Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                    Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+                    Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
+                    Matrix<ElemType>& sg = *m_blockLevelSmoothedGradient[i]->GetWritableMatrix<ElemType>();
+
+                    if (currentWeight.GetDeviceId() == CPUDEVICE)
+                        UpdateModelCPU(blockMomentum, blockGrad, sg, previousWeight, currentWeight);
+                    else
+                        UpdateModel(blockMomentum, blockGrad, sg, previousWeight, currentWeight);
+                }
+
+                PackValues<ElemType>(parameterValues, buffer);
+            }
+
+            // Only leaders keep the smoothed gradients up to date; the main worker, which writes checkpoints, is a leader.
+            exchange.BroadcastFromLeader(buffer, numElements);
+            if (!exchange.IsLeader())
+            {
+                UnpackValues<ElemType>(parameterValues, buffer);
+                for (size_t i = 0; i < parameterValues.size(); ++i)
+                    m_prevParameters[i]->CopyFrom(*parameterValues[i]);
+            }
+
+            m_hostAveragingsInCurrentBlock = 0;
+            m_hierarchicalBlockSamples = 0;
+            return true;
+        }
+
+        // Gossip: the model is averaged with the model received from the peer of this round, which keeps the mean over
+        // all workers. The block gradient of the averaged model is scaled by the number of workers, since it estimates
+        // the average of the block gradients that the global update would sum, and the block update is applied locally.
+        template<class ElemType>
+        void SynchronizeModelGossip(const std::vector<NDArrayViewPtr>& parameterValues)
+        {
+            Microsoft::MSR::CNTK::ScopedAggregationPhase totalPhase(Microsoft::MSR::CNTK::AggregationPhase::Total);
+
+            size_t numElements = 0;
+            for (const auto& value : parameterValues)
+                numElements += value->Shape().TotalSize();
+
+            // The models at the previous and at this synchronization are averaged with those of the peer, so that the block
+            // gradient is the average of the block gradients of both, from a common starting point.
+            m_gossipBuffer.resize(4 * numElements * sizeof(ElemType));
+            ElemType* local = reinterpret_cast<ElemType*>(m_gossipBuffer.data());
+            ElemType* received = local + 2 * numElements;
+
+            {
+                Microsoft::MSR::CNTK::ScopedAggregationPhase aggregationPhase(Microsoft::MSR::CNTK::AggregationPhase::ModelAggregation);
+                PackValues<ElemType>(m_prevParameters, local);
+                PackValues<ElemType>(parameterValues, local + numElements);
+                m_gossipExchange->Exchange(m_gossipRound++, local, received, 2 * numElements);
+
+                const long long n = (long long)(2 * numElements);
+#pragma omp parallel for
+                for (long long k = 0; k < n; ++k)
+                    local[k] = (ElemType)0.5 * (local[k] + received[k]);
+
+                UnpackValues<ElemType>(m_prevParameters, local);
+                UnpackValues<ElemType>(parameterValues, local + numElements);
+            }
+
+            Microsoft::MSR::CNTK::ScopedAggregationPhase updatePhase(Microsoft::MSR::CNTK::AggregationPhase::ModelUpdate);
+            ElemType blockMomentum = (ElemType)TimeConstant2Momentum(m_blockMomentumAsTimeConstantPerWorker, m_numSamplesSeenInCurrentBlock);
+            for (size_t i = 0; i < parameterValues.size(); ++i)
+            {
+                Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& sg = *m_blockLevelSmoothedGradient[i]->GetWritableMatrix<ElemType>();
+
+                blockGrad.AssignDifferenceOf(previousWeight, currentWeight);
+
+                if (currentWeight.GetDeviceId() == CPUDEVICE)
+                    UpdateModelCPU(blockMomentum, blockGrad, sg, previousWeight, currentWeight);
+                else
+                    UpdateModel(blockMomentum, blockGrad, sg, previousWeight, currentWeight);
+            }
+        }
+
+        // Replaces the models of all workers by their exact average, e.g. so that the checkpoint holds the consensus model.
+        template<class ElemType>
+        void AverageModels(const std::vector<NDArrayViewPtr>& parameterValues)
+        {
+            Microsoft::MSR::CNTK::ScopedAggregationPhase totalPhase(Microsoft::MSR::CNTK::AggregationPhase::Total);
+
+            std::vector<NDArrayViewPtr> parameterChunks;
+            for (const auto& value : parameterValues)
+                SplitForAggregation<ElemType>(value, parameterChunks);
+
+            m_communicator->AggregateInPlace(parameterChunks, m_communicator->Workers());
+
+            const ElemType scale = (ElemType)(1.0 / m_communicator->Workers().size());
+            for (size_t i = 0; i < parameterValues.size(); ++i)
+            {
+                Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+                currentWeight *= scale;
+                m_prevParameters[i]->CopyFrom(*parameterValues[i]);
+            }
+        }
+
+        // Copies the values into consecutive ranges of a host buffer, and back.
+        template<class ElemType>
+        static void PackValues(const std::vector<NDArrayViewPtr>& values, ElemType* buffer)
+        {
+            for (const auto& value : values)
+            {
+                const Matrix<ElemType>& matrix = *value->GetMatrix<ElemType>();
+                size_t numElements = matrix.GetNumElements();
+                matrix.CopyToArray(buffer, numElements);
+                buffer += numElements;
+            }
+        }
+
+        template<class ElemType>
+        static void UnpackValues(const std::vector<NDArrayViewPtr>& values, ElemType* buffer)
+        {
+            for (const auto& value : values)
+            {
+                Matrix<ElemType>& matrix = *value->GetWritableMatrix<ElemType>();
+                matrix.SetValue(matrix.GetNumRows(), matrix.GetNumCols(), matrix.GetDeviceId(), buffer);
+                buffer += matrix.GetNumElements();
+            }
+        }
+
+        // Computes the block gradients and flags the parameters whose block gradient is significant on this worker.
+        void EvaluateSignificance(double* significance)
+        {
+            std::vector<NDArrayViewPtr> parameterValues;
+            GetParameterValues(m_learner->Parameters(), parameterValues);
+            if (!parameterValues.empty())
+            {
+                if (parameterValues.front()->GetDataType() == DataType::Double)
+                    EvaluateSignificance<double>(parameterValues, significance);
+                else
+                    EvaluateSignificance<float>(parameterValues, significance);
+            }
+
+            m_blockGradientsComputed = true;
+        }
+
+        // The squared norms of the block gradients and previous weights of all parameters are computed into one matrix
+        // on the device of the parameters, which is read back once.
+        template<class ElemType>
+        void EvaluateSignificance(const std::vector<NDArrayViewPtr>& parameterValues, double* significance)
+        {
+            const size_t numParameters = parameterValues.size();
+            Matrix<ElemType> squaredNorms(1, 2 * numParameters, parameterValues.front()->GetMatrix<ElemType>()->GetDeviceId());
+            squaredNorms.SetValue(0);
+            for (size_t i = 0; i < numParameters; ++i)
+            {
+                // Parameters not due by their schedule are skipped anyway.
+                if (!IsParameterDue(i))
+                    continue;
+
+                Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
+                blockGrad.AssignDifferenceOf(previousWeight, *parameterValues[i]->GetMatrix<ElemType>());
+                squaredNorms.ColumnSlice(2 * i, 1).AssignInnerProductOfMatrices(blockGrad, blockGrad);
+                squaredNorms.ColumnSlice(2 * i + 1, 1).AssignInnerProductOfMatrices(previousWeight, previousWeight);
+            }
+
+            std::vector<ElemType> hostSquaredNorms(2 * numParameters);
+            squaredNorms.CopySection(1, 2 * numParameters, hostSquaredNorms.data(), 1);
+            for (size_t i = 0; i < numParameters; ++i)
+            {
+                double blockGradNorm = sqrt((double)hostSquaredNorms[2 * i]);
+                double previousWeightNorm = sqrt((double)hostSquaredNorms[2 * i + 1]);
+                significance[i] = (IsParameterDue(i) && blockGradNorm > 0 && blockGradNorm >= m_significanceThreshold * previousWeightNorm) ? 1 : 0;
+            }
+        }
+
+        // Sums the block gradients of the parameters aggregated in this block over all workers.
+        template<class ElemType>
+        void AggregateSelectedBlockGradients()
+        {
+            m_selectedBlockGradientChunks.clear();
+            for (size_t i = 0; i < m_tempBlockGradient.size(); ++i)
+            {
+                if (IsParameterAggregated(i))
+                    SplitForAggregation<ElemType>(m_tempBlockGradient[i], m_selectedBlockGradientChunks);
+            }
+
+            if (!m_selectedBlockGradientChunks.empty())
+                m_communicator->AggregateInPlace(m_selectedBlockGradientChunks, m_communicator->Workers());
+        }
+
+        bool FiltersParameters() const
+        {
+            return m_significanceThreshold > 0 || !m_parameterSyncPeriods.empty();
+        }
+
+        // Whether the parameter is due in the current block according to its schedule.
+        bool IsParameterDue(size_t index) const
+        {
+            return m_aggregateAllParameters || m_parameterSyncPeriods.empty() || ((m_blockIndex + m_parameterSyncPhases[index]) % m_parameterSyncPeriods[index] == 0);
+        }
+
+        // Whether the parameter is aggregated in the current block: it is due and, with significance filtering, was agreed on.
+        bool IsParameterAggregated(size_t index) const
+        {
+            return IsParameterDue(index) && (m_parameterSignificant.empty() || m_aggregateAllParameters || m_parameterSignificant[index]);
+        }
+
+        // Resolves the schedules by parameter and assigns the phases: parameters are placed, largest first, at the phase of
+        // their period at which the most loaded block of the schedule is least loaded. The result only depends on the
+        // parameters and the schedules, so it is the same on all workers.
+        void BuildParameterSchedule(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& parameterValues,
+                                    const std::map<std::wstring, BlockMomentumParameterSchedule>& schedules)
+        {
+            const size_t maxScheduleBlocks = 1024;
+            size_t scheduleBlocks = 1;
+            m_parameterSyncPeriods.assign(parameters.size(), 1);
+            m_parameterSyncPhases.assign(parameters.size(), 0);
+            m_parameterTimeConstants.assign(parameters.size(), m_blockMomentumAsTimeConstantPerWorker);
+            for (size_t i = 0; i < parameters.size(); ++i)
+            {
+                auto schedule = schedules.find(parameters[i].Name());
+                if (schedule == schedules.end())
+                    continue;
+
+                if (schedule->second.syncEveryBlocks == 0)
+                    InvalidArgument("Parameter '%ls' has a sync period of 0 blocks.", parameters[i].Name().c_str());
+
+                m_parameterSyncPeriods[i] = schedule->second.syncEveryBlocks;
+                if (schedule->second.blockMomentumAsTimeConstant > 0)
+                    m_parameterTimeConstants[i] = schedule->second.blockMomentumAsTimeConstant / m_communicator->Workers().size();
+
+                // The load is tracked over the least common multiple of the periods, up to a bound.
+                size_t a = scheduleBlocks, b = m_parameterSyncPeriods[i];
+                while (b != 0) { size_t t = a % b; a = b; b = t; }
+                scheduleBlocks = std::min(scheduleBlocks / a * m_parameterSyncPeriods[i], maxScheduleBlocks);
+            }
+
+            std::vector<size_t> order(parameters.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&parameterValues](size_t a, size_t b) { return parameterValues[a]->Shape().TotalSize() > parameterValues[b]->Shape().TotalSize(); });
+
+            std::vector<size_t> blockLoad(scheduleBlocks, 0);
+            for (size_t i : order)
+            {
+                size_t period = m_parameterSyncPeriods[i];
+                size_t bestPhase = 0;
+                size_t bestLoad = SIZE_MAX;
+                for (size_t phase = 0; phase < period && phase < scheduleBlocks; ++phase)
+                {
+                    size_t load = 0;
+                    for (size_t block = (period - phase) % period; block < scheduleBlocks; block += period)
+                        load = std::max(load, blockLoad[block]);
+
+                    if (load < bestLoad)
+                    {
+                        bestLoad = load;
+                        bestPhase = phase;
+                    }
+                }
+
+                m_parameterSyncPhases[i] = bestPhase;
+                for (size_t block = (period - bestPhase) % period; block < scheduleBlocks; block += period)
+                    blockLoad[block] += parameterValues[i]->Shape().TotalSize();
+            }
+        }
+
+        // Sums m_tempBlockGradient over all workers.
+        void AggregateBlockGradients()
+        {
+            if (m_quantizedCommunicator)
+            {
+                // The quantized exchange sends large values in chunks by itself.
+                m_quantizedCommunicator->QuantizedAggregateInPlace(
+                    m_tempBlockGradient,
+                    m_blockGradientResiduals,
+                    m_blockGradientStripeResiduals,
+                    m_communicator->Workers());
+            }
+            else
+            {
+                m_communicator->AggregateInPlace(m_tempBlockGradientChunks, m_communicator->Workers());
+            }
+        }
+
+        void ResetQuantizationResiduals()
+        {
+            for (auto& residuals : { &m_blockGradientResiduals, &m_blockGradientStripeResiduals })
+            {
+                for (auto& residual : *residuals)
+                {
+                    if (!residual)
+                        continue;
+
+                    if (residual->GetDataType() == DataType::Double)
+                        residual->SetValue(0.0);
+                    else
+                        residual->SetValue(0.0f);
+                }
+            }
+        }
+
+        void WaitForAsyncAggregation()
+        {
+            if (m_asyncAggregationPending)
+                WaitForAsyncAggregationTimed();
+        }
+
+        // Waits for the aggregation in flight and forgets about it. The flag is cleared before waiting, so that an
+        // aggregation that failed is not waited for again.
+        void FinishAsyncAggregation()
+        {
+            if (!m_asyncAggregationPending)
+                return;
+
+            m_asyncAggregationPending = false;
+            WaitForAsyncAggregationTimed();
+        }
+
+        // The time spent waiting for an aggregation in the background is part of the cost of the synchronization.
+        void WaitForAsyncAggregationTimed()
+        {
+            auto waitBeginTime = std::chrono::steady_clock::now();
+            m_asyncAggregationEngine->Wait(m_asyncAggregationTicket);
+            m_asyncWaitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitBeginTime).count();
+        }
+
+        // Applies the aggregation in flight: the global model gets the block momentum update and the
+        // local model the same update on top of the progress made since the aggregation was launched.
+        template<class ElemType>
+        void CompleteAsyncAggregation(const std::vector<NDArrayViewPtr>& parameterValues)
+        {
+            FinishAsyncAggregation();
+
+            Microsoft::MSR::CNTK::ScopedAggregationPhase updatePhase(Microsoft::MSR::CNTK::AggregationPhase::ModelUpdate);
+            ElemType blockMomentum = (ElemType)TimeConstant2Momentum(m_blockMomentumAsTimeConstantPerWorker, m_asyncAggregationBlockSamples);
+            for (size_t i = 0; i < parameterValues.size(); ++i)
+            {
+                Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& blockGrad = *m_tempBlockGradient[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& sg = *m_blockLevelSmoothedGradient[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& launchWeight = *m_asyncLaunchParameters[i]->GetWritableMatrix<ElemType>();
+
+                Matrix<ElemType>::ScaleAndAdd((ElemType)((1 - blockMomentum)*m_blockLearningRate), blockGrad, (ElemType)blockMomentum, sg);
+                Matrix<ElemType>::ScaleAndAdd(m_useNesterovMomentum ? (ElemType)-(1 + blockMomentum) : (ElemType)-1, sg, previousWeight);
+
+                currentWeight += previousWeight;
+                currentWeight -= launchWeight;
+            }
+        }
+
+        // Lean state: the parameters themselves hold the block gradient. It is reduce-scattered such that each worker holds the
+        // aggregated block gradient of its shard, updates the smoothed gradient and the weights of the shard, and the updated
+        // shards are allgathered into the parameters of all workers.
+        template<class ElemType>
+        void SynchronizeModelLean(const std::vector<NDArrayViewPtr>& parameterValues, ElemType blockMomentum)
+        {
+            Microsoft::MSR::CNTK::ScopedAggregationPhase totalPhase(Microsoft::MSR::CNTK::AggregationPhase::Total);
+
+            for (size_t i = 0; i < parameterValues.size(); ++i)
+            {
+                Matrix<ElemType>& previousWeight = *m_prevParameters[i]->GetWritableMatrix<ElemType>();
+                Matrix<ElemType>& currentWeight = *parameterValues[i]->GetWritableMatrix<ElemType>();
+
+                // currentWeight = previousWeight - currentWeight, the local block gradient
+                Matrix<ElemType>::ScaleAndAdd((ElemType)1, previousWeight, (ElemType)-1, currentWeight);
+            }
+
+            const std::vector<size_t> shardSizes = ShardSizes(parameterValues);
+            auto copyOut = [this, &parameterValues](int rank, ElemType* host) { CopyShards<ElemType>(parameterValues, rank, host, /*toHost=*/true); };
+            auto copyIn = [this, &parameterValues](int rank, ElemType* host) { CopyShards<ElemType>(parameterValues, rank, host, /*toHost=*/false); };
+            {
+                Microsoft::MSR::CNTK::ScopedAggregationPhase aggregationPhase(Microsoft::MSR::CNTK::AggregationPhase::ModelAggregation);
+                m_shardExchange->ReduceScatter<ElemType>(shardSizes, copyOut, copyIn);
+            }
+
+            {
+                Microsoft::MSR::CNTK::ScopedAggregationPhase updatePhase(Microsoft::MSR::CNTK::AggregationPhase::ModelUpdate);
+                const ElemType gradientScale = (ElemType)((1 - blockMomentum)*m_blockLearningRate);
+                const ElemType weightScale = m_useNesterovMomentum ? (1 + blockMomentum) : (ElemType)1;
+                for (size_t i = 0; i < parameterValues.size(); ++i)
+                {
+                    const NDArrayViewPtr& value = parameterValues[i];
+                    auto shard = LocalShard(value->Shape().TotalSize());
+                    if (shard.second == 0)
+                        continue;
+
+                    if (value->Device() == DeviceDescriptor::CPUDevice())
+                    {
+                        const ElemType* previousWeight = m_prevParameters[i]->DataBuffer<ElemType>() + shard.first;
+                        ElemType* currentWeight = value->WritableDataBuffer<ElemType>() + shard.first;
+                        if (m_useHalfPrecisionSmoothedGradient)
+                            UpdateShardCPU(blockMomentum, gradientScale, weightScale, previousWeight, currentWeight, m_halfSmoothedGradients[i].data(), shard.second);
+                        else
+                            UpdateShardCPU(blockMomentum, gradientScale, weightScale, previousWeight, currentWeight, m_blockLevelSmoothedGradient[i]->WritableDataBuffer<ElemType>(), shard.second);
+                    }
+                    else
+                    {
+                        // The views and their matrices are temporaries, keep them alive while the shard is updated.
+                        NDArrayViewPtr previousWeightView = ElementRangeView<ElemType>(m_prevParameters[i], shard.first, shard.second);
+                        NDArrayViewPtr currentWeightView = ElementRangeView<ElemType>(value, shard.first, shard.second);
+                        auto previousWeightMatrix = previousWeightView->GetWritableMatrix<ElemType>();
+                        auto currentWeightMatrix = currentWeightView->GetWritableMatrix<ElemType>();
+                        Matrix<ElemType>& previousWeight = *previousWeightMatrix;
+                        Matrix<ElemType>& currentWeight = *currentWeightMatrix;
+                        Matrix<ElemType>& sg = *m_blockLevelSmoothedGradient[i]->GetWritableMatrix<ElemType>();
+
+                        Matrix<ElemType>::ScaleAndAdd(gradientScale, currentWeight, blockMomentum, sg);
+                        currentWeight.SetValue(previousWeight);
+                        Matrix<ElemType>::ScaleAndAdd(-weightScale, sg, currentWeight);
+                    }
+                }
+            }
+
+            {
+                Microsoft::MSR::CNTK::ScopedAggregationPhase aggregationPhase(Microsoft::MSR::CNTK::AggregationPhase::ModelAggregation);
+                m_shardExchange->Allgather<ElemType>(shardSizes, copyOut, copyIn);
+            }
+
+            for (size_t i = 0; i < parameterValues.size(); ++i)
+                m_prevParameters[i]->GetWritableMatrix<ElemType>()->SetValue(*parameterValues[i]->GetMatrix<ElemType>());
+        }
+
+        // Block momentum update of a shard on the CPU; 'currentWeight' holds the aggregated block gradient on entry.
+        template<class ElemType, class SmoothedGradientType>
+        static void UpdateShardCPU(ElemType blockMomentum, ElemType gradientScale, ElemType weightScale, const ElemType* previousWeight, ElemType* currentWeight, SmoothedGradientType* sg, size_t numElements)
+        {
+#pragma omp parallel for
+            for (long long k = 0; k < (long long)numElements; ++k)
+            {
+                ElemType smoothed = blockMomentum * (ElemType)LoadSmoothedGradient(sg[k]) + gradientScale * currentWeight[k];
+                StoreSmoothedGradient(sg[k], smoothed);
+                currentWeight[k] = previousWeight[k] - weightScale * smoothed;
+            }
+        }
+
+        static double LoadSmoothedGradient(float value) { return value; }
+        static double LoadSmoothedGradient(double value) { return value; }
+        static double LoadSmoothedGradient(uint16_t value) { return HalfToFloat(value); }
+        static void StoreSmoothedGradient(float& target, double value) { target = (float)value; }
+        static void StoreSmoothedGradient(double& target, double value) { target = value; }
+        static void StoreSmoothedGradient(uint16_t& target, double value) { target = FloatToHalf((float)value); }
+
+        // IEEE 754 binary16 conversion, rounding to nearest even.
+        static uint16_t FloatToHalf(float value)
+        {
+            uint32_t x;
+            memcpy(&x, &value, sizeof(x));
+            uint32_t sign = (x >> 16) & 0x8000;
+            uint32_t mantissa = x & 0x007FFFFF;
+            uint32_t biasedExponent = (x >> 23) & 0xFF;
+            if (biasedExponent == 0xFF) // Inf or NaN
+                return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+            int exponent = (int)biasedExponent - 127 + 15;
+            if (exponent >= 31) // Overflow
+                return (uint16_t)(sign | 0x7C00);
+
+            if (exponent <= 0) // Subnormal or zero
+            {
+                if (exponent < -10)
+                    return (uint16_t)sign;
+
+                mantissa |= 0x00800000;
+                int shift = 14 - exponent;
+                uint32_t half = mantissa >> shift;
+                uint32_t remainder = mantissa & ((1u << shift) - 1);
+                uint32_t midpoint = 1u << (shift - 1);
+                if (remainder > midpoint || (remainder == midpoint && (half & 1)))
+                    half++;
+                return (uint16_t)(sign | half);
+            }
+
+            // A carry out of the mantissa correctly increments the exponent.
+            uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+            uint32_t remainder = mantissa & 0x1FFF;
+            if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+                half++;
+            return (uint16_t)(sign | half);
+        }
+
+        static float HalfToFloat(uint16_t value)
+        {
+            uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+            uint32_t exponent = (value >> 10) & 0x1F;
+            uint32_t mantissa = value & 0x3FF;
+            uint32_t x;
+            if (exponent == 0x1F)
+                x = sign | 0x7F800000 | (mantissa << 13);
+            else if (exponent != 0)
+                x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+            else if (mantissa == 0)
+                x = sign;
+            else
+            {
+                // Normalize the subnormal
+                uint32_t shift = 0;
+                while (!(mantissa & 0x400))
+                {
+                    mantissa <<= 1;
+                    shift++;
+                }
+
+                x = sign | ((127 - 15 + 1 - shift) << 23) | ((mantissa & 0x3FF) << 13);
+            }
+
+            float result;
+            memcpy(&result, &x, sizeof(result));
+            return result;
+        }
+
+        // Range (begin, size) of the elements of a parameter whose block momentum state is held by the given worker.
+        std::pair<size_t, size_t> Shard(size_t numElements, size_t rank) const
+        {
+            size_t numWorkers = m_communicator->Workers().size();
+            size_t numElementsPerWorker = numElements / numWorkers;
+            size_t residue = numElements % numWorkers;
+            return std::make_pair((numElementsPerWorker * rank) + std::min(residue, rank), numElementsPerWorker + ((rank < residue) ? 1 : 0));
+        }
+
+        std::pair<size_t, size_t> LocalShard(size_t numElements) const
+        {
+            return Shard(numElements, m_communicator->CurrentWorker().m_globalRank);
+        }
+
+        // Number of elements of the shards of all parameters held by every worker, the unit of the shard exchange.
+        std::vector<size_t> ShardSizes(const std::vector<NDArrayViewPtr>& values) const
+        {
+            std::vector<size_t> shardSizes(m_communicator->Workers().size(), 0);
+            for (size_t rank = 0; rank < shardSizes.size(); ++rank)
+            {
+                for (const auto& value : values)
+                    shardSizes[rank] += Shard(value->Shape().TotalSize(), rank).second;
+            }
+
+            return shardSizes;
+        }
+
+        // Copies the shards of the given worker of all values, one after the other, to a host buffer or from it.
+        template<class ElemType>
+        void CopyShards(const std::vector<NDArrayViewPtr>& values, int rank, ElemType* host, bool toHost) const
+        {
+            for (const auto& value : values)
+            {
+                auto shard = Shard(value->Shape().TotalSize(), (size_t)rank);
+                if (shard.second == 0)
+                    continue;
+
+                auto hostView = std::make_shared<NDArrayView>(AsDataType<ElemType>(), NDShape{ shard.second }, host, shard.second * sizeof(ElemType), DeviceDescriptor::CPUDevice());
+                auto shardView = ElementRangeView<ElemType>(value, shard.first, shard.second);
+                if (toHost)
+                    hostView->CopyFrom(*shardView);
+                else
+                    shardView->CopyFrom(*hostView);
+
+                host += shard.second;
+            }
+        }
+
+        template<class ElemType>
+        static NDArrayViewPtr ElementRangeView(const NDArrayViewPtr& value, size_t begin, size_t numElements)
+        {
+            return std::make_shared<NDArrayView>(AsDataType<ElemType>(), NDShape{ numElements }, value->WritableDataBuffer<ElemType>() + begin, numElements * sizeof(ElemType), value->Device());
+        }
+
+        template<class ElemType>
+        void ResetSmoothedGradientShard(size_t index, const NDArrayViewPtr& p)
+        {
+            size_t shardSize = LocalShard(p->Shape().TotalSize()).second;
+            if (m_useHalfPrecisionSmoothedGradient)
+            {
+                if (p->Device() != DeviceDescriptor::CPUDevice())
+                    InvalidArgument("16-bit smoothed gradients are only supported for parameters on the CPU.");
+
+                if (m_halfSmoothedGradients[index].size() != shardSize)
+                    m_halfSmoothedGradients[index].assign(shardSize, 0);
+            }
+            else if (!m_blockLevelSmoothedGradient[index] && shardSize > 0)
+            {
+                auto shard = std::make_shared<NDArrayView>(AsDataType<ElemType>(), NDShape{ shardSize }, p->Device());
+                shard->SetValue(static_cast<ElemType>(0));
+                m_blockLevelSmoothedGradient[index] = shard;
+            }
+        }
+
+        template<class ElemType>
+        void RestoreSmoothedGradientShard(size_t index, const NDArrayView& smoothedGradient)
+        {
+            auto shard = LocalShard(smoothedGradient.Shape().TotalSize());
+            if (shard.second == 0)
+                return;
+
+            if (m_useHalfPrecisionSmoothedGradient)
+            {
+                const ElemType* data = smoothedGradient.DataBuffer<ElemType>() + shard.first;
+                m_halfSmoothedGradients[index].resize(shard.second);
+                for (size_t k = 0; k < shard.second; ++k)
+                    StoreSmoothedGradient(m_halfSmoothedGradients[index][k], data[k]);
+            }
+            else
+            {
+                m_blockLevelSmoothedGradient[index]->CopyFrom(*smoothedGradient.AsShape(NDShape{ smoothedGradient.Shape().TotalSize() })->SliceView({ shard.first }, { shard.second }));
+            }
+        }
+
+        // Full smoothed gradients, allgathered from the shards of all workers. Collective. They are assembled in buffers on
+        // the CPU, which are kept for the next checkpoint and do not take device memory.
+        const std::vector<NDArrayViewPtr>& GatherSmoothedGradients(const std::vector<NDArrayViewPtr>& parameterValues)
+        {
+            if (parameterValues.empty())
+                return m_gatheredSmoothedGradients;
+
+            if (parameterValues.front()->GetDataType() == DataType::Double)
+                GatherSmoothedGradientShards<double>(parameterValues);
+            else
+                GatherSmoothedGradientShards<float>(parameterValues);
+
+            return m_gatheredSmoothedGradients;
+        }
+
+        template<class ElemType>
+        void GatherSmoothedGradientShards(const std::vector<NDArrayViewPtr>& parameterValues)
+        {
+            m_gatheredSmoothedGradients.resize(parameterValues.size());
+            for (size_t i = 0; i < parameterValues.size(); ++i)
+            {
+                auto& full = m_gatheredSmoothedGradients[i];
+                if (!full || full->Shape() != parameterValues[i]->Shape())
+                    full = std::make_shared<NDArrayView>(AsDataType<ElemType>(), parameterValues[i]->Shape(), DeviceDescriptor::CPUDevice());
+
+                auto shard = LocalShard(full->Shape().TotalSize());
+                if (shard.second == 0)
+                    continue;
+
+                if (m_useHalfPrecisionSmoothedGradient)
+                {
+                    ElemType* data = full->WritableDataBuffer<ElemType>() + shard.first;
+                    for (size_t k = 0; k < shard.second; ++k)
+                        data[k] = (ElemType)LoadSmoothedGradient(m_halfSmoothedGradients[i][k]);
+                }
+                else
+                {
+                    ElementRangeView<ElemType>(full, shard.first, shard.second)->CopyFrom(*m_blockLevelSmoothedGradient[i]);
+                }
+            }
+
+            auto& gathered = m_gatheredSmoothedGradients;
+            auto copyOut = [this, &gathered](int rank, ElemType* host) { CopyShards<ElemType>(gathered, rank, host, /*toHost=*/true); };
+            auto copyIn = [this, &gathered](int rank, ElemType* host) { CopyShards<ElemType>(gathered, rank, host, /*toHost=*/false); };
+            m_shardExchange->Allgather<ElemType>(ShardSizes(gathered), copyOut, copyIn);
+        }
+
+        // Block momentum model update:
+        // 1. update block level smoothed gradient;
+        //    This is essentially a first-order infinite impulse response (IIR) filter with the gain (1 - blockMomentum)*m_blockLearningRate:
+        //    smoothedGradient(t)=blockMomentum * smoothedGradients(t-1) + (1 - blockMomentum)*m_blockLearningRate*blockGrad(t)
+        // 2. update parameters: w(t) = w(t-1) - smoothedGradient(t)
+        // 3. Nesterov Momentum
+        //    A Nesterov momentum here is to do a partial weight update before calculating the gradient, i.e.,
+        //    (step 1) w(t) <-- w(t) - \eta* v(t)
+        //    (step 2) g(t+1) <-- forwardbackward on minibatches with initial model as w(t)
+        //    (step 3) v(t+1) <-- \eta*v(t) + (1-\eta)*learningRate*g(t+1)
+        //    (step 4) w(t+1) <-- w(t)-v(t)
+        //    (step 5) t      <-- t+1
+        //    without step 1, this becomes stanard momentum
+        // 4. update bookkeeping: prev = w(t)
+        template<class ElemType>
+        void UpdateModel(ElemType blockMomentum, const Matrix<ElemType>& blockGrad, Matrix<ElemType>& sg, Matrix<ElemType>& previousWeight, Matrix<ElemType>& currentWeight) const
+        {
+            Matrix<ElemType>::ScaleAndAdd((ElemType)((1 - blockMomentum)*m_blockLearningRate), blockGrad, (ElemType)blockMomentum, sg);
+            if (m_useNesterovMomentum)
+            {
+                currentWeight.SetValue(previousWeight);
+                Matrix<ElemType>::ScaleAndAdd((ElemType)-(1 + blockMomentum), sg, currentWeight);
+            }
+            else
+            {
+                currentWeight.AssignDifferenceOf(previousWeight, sg);
+            }
+
+            previousWeight.SetValue(currentWeight);
+        }
+
+        // Same as UpdateModel in a single pass over the buffers; the update is bound by memory bandwidth.
+        template<class ElemType>
+        void UpdateModelCPU(ElemType blockMomentum, const Matrix<ElemType>& blockGrad, Matrix<ElemType>& sg, Matrix<ElemType>& previousWeight, Matrix<ElemType>& currentWeight) const
+        {
+            const ElemType gradientScale = (ElemType)((1 - blockMomentum)*m_blockLearningRate);
+            const ElemType nesterovScale = m_useNesterovMomentum ? blockMomentum : (ElemType)0;
+            const ElemType* g = blockGrad.Data();
+            ElemType* s = sg.Data();
+            ElemType* prev = previousWeight.Data();
+            ElemType* w = currentWeight.Data();
+
+            const long long numElements = (long long)currentWeight.GetNumElements();
+#pragma omp parallel for
+            for (long long k = 0; k < numElements; ++k)
+            {
+                ElemType smoothed = blockMomentum * s[k] + gradientScale * g[k];
+                ElemType weight = prev[k] - smoothed - nesterovScale * smoothed;
+                s[k] = smoothed;
+                w[k] = weight;
+                prev[k] = weight;
+            }
+        }
+
+        // MPI counts are ints, so values with more elements than fit into a single message are
+        // aggregated as several views over consecutive ranges of their buffer.
+        template<class ElemType>
+        static void SplitForAggregation(const NDArrayViewPtr& value, std::vector<NDArrayViewPtr>& result)
+        {
+            const size_t maxChunkElements = Microsoft::MSR::CNTK::MaxMessageChunkBytes / sizeof(ElemType);
+            size_t numElements = value->Shape().TotalSize();
+            if (numElements <= maxChunkElements)
+            {
+                result.push_back(value);
+                return;
+            }
+
+            ElemType* data = value->WritableDataBuffer<ElemType>();
+            for (size_t offset = 0; offset < numElements; offset += maxChunkElements)
+            {
+                size_t chunkElements = std::min(maxChunkElements, numElements - offset);
+                result.push_back(std::make_shared<NDArrayView>(AsDataType<ElemType>(), NDShape{ chunkElements }, data + offset, chunkElements * sizeof(ElemType), value->Device()));
+            }
+        }
+
+        static double TimeConstant2Momentum(double timeConstant, size_t syncPeroid)
+        {
+            if (timeConstant == 0)
+                return 0;
+            else
+                return exp(-((double)syncPeroid) / timeConstant);
+        }
+
+        static double Momentum2TimeConstant(double bm, size_t syncPeroid)
+        {
+            if (bm >= 1.0 || bm < 0.0)
+            {
+                InvalidArgument("Unexpected block momentum (%.2f). Block momentum should be in the range of [0,1)\n", bm);
+            }
+            return -(double)syncPeroid / log(bm);
+        }
+
+        const bool m_resetSGDMomentumAfterAggregation;
+        const bool m_useNesterovMomentum;
+        const double m_blockLearningRate;
+        const double m_blockMomentumAsTimeConstantPerWorker;
+
+        // Adapted at synchronization points by m_syncPeriodController, if any.
+        size_t m_syncPeriodPerWorker;
+        const size_t m_globalModelAggregationBlockSize;
+        size_t m_numSamplesSeenInCurrentBlock;
+        size_t m_localTotalNumSamplesSeen;
+
+        // parameters at the last model aggregation point
+        std::vector<NDArrayViewPtr> m_prevParameters;
+        std::vector<NDArrayViewPtr> m_blockLevelSmoothedGradient;
+        std::vector<NDArrayViewPtr> m_tempBlockGradient;
+
+        // Views over m_tempBlockGradient that are small enough to be aggregated in a single MPI call.
+        std::vector<NDArrayViewPtr> m_tempBlockGradientChunks;
+
+        // Control word of SynchronizeAction: a count per action followed by the number of samples,
+        // with an adaptive sync period the number of workers that measured a block and the measurements,
+        // and with piggybacked metrics the sums of the metrics since the last synchronization.
+        static const size_t ControlWordSamples = static_cast<size_t>(Action::Shutdown) + 1;
+        static const size_t ControlWordMeasured = ControlWordSamples + 1;
+        static const size_t ControlWordSyncSeconds = ControlWordMeasured + 1;
+        static const size_t ControlWordComputeSeconds = ControlWordSyncSeconds + 1;
+        static const size_t ControlWordBlockSamples = ControlWordComputeSeconds + 1;
+        static const size_t ControlWordTrainingLoss = ControlWordBlockSamples + 1;
+        static const size_t ControlWordEvalCriterion = ControlWordTrainingLoss + 1;
+        static const size_t ControlWordSize = ControlWordEvalCriterion + 1;
+        NDArrayViewPtr m_controlWord;
+        std::vector<NDArrayViewPtr> m_controlWordBuffer;
+
+        bool m_prevParamInitialized = false;
+
+        // Adaptive sync period: duration of the last synchronization, time waited for the async aggregation since,
+        // and start of the current block.
+        std::unique_ptr<Microsoft::MSR::CNTK::AdaptiveSyncPeriodController> m_syncPeriodController;
+        double m_lastSyncSeconds = 0;
+        double m_asyncWaitSeconds = 0;
+        std::chrono::steady_clock::time_point m_blockStartTime;
+        bool m_hasBlockTiming = false;
+
+        bool m_endOfDataReached;
+        bool m_shutDownSeenBefore = false;
+
+        // Async aggregation: the block gradient aggregated in the background is m_tempBlockGradient and
+        // m_prevParameters is the global model it applies to. Weights at the launch of the aggregation.
+        const bool m_useAsyncAggregation;
+        std::vector<NDArrayViewPtr> m_asyncLaunchParameters;
+        bool m_asyncAggregationPending = false;
+        size_t m_asyncAggregationTicket = 0;
+        size_t m_asyncAggregationBlockSamples = 0;
+        int m_asyncDeviceId = CPUDEVICE;
+        std::unique_ptr<Microsoft::MSR::CNTK::MatrixComputeStreamEvent> m_asyncMainStreamSyncEvent;
+
+        // Quantized block gradient exchange, null if block gradients are aggregated in full precision.
+        QuantizedDistributedCommunicator* m_quantizedCommunicator;
+        // Residuals of the quantized block gradients and of the aggregated stripes this worker is responsible for.
+        std::vector<NDArrayViewPtr> m_blockGradientResiduals;
+        std::vector<NDArrayViewPtr> m_blockGradientStripeResiduals;
+
+        // Lean state: m_blockLevelSmoothedGradient only holds this worker's shard, or with 16-bit storage
+        // m_halfSmoothedGradients does, and m_tempBlockGradient is not allocated.
+        const bool m_useLeanState;
+        const bool m_useHalfPrecisionSmoothedGradient;
+        std::vector<std::vector<uint16_t>> m_halfSmoothedGradients;
+        // Exchange of the shards, and the full smoothed gradients assembled on the CPU for checkpoints.
+        std::unique_ptr<Microsoft::MSR::CNTK::ShardExchange> m_shardExchange;
+        std::vector<NDArrayViewPtr> m_gatheredSmoothedGradients;
+
+        // MPI of the point-to-point exchanges of the lean, hierarchical and gossip modes.
+        Microsoft::MSR::CNTK::MPIWrapperPtr m_mpi;
+
+        // Pipelined synchronization: [begin, end) parameter ranges of the groups, the views over their block gradients
+        // that are aggregated, and the compute stream event and engine ticket of each group of the current synchronization.
+        const size_t m_pipelinedAggregationGroupBytes;
+        std::vector<std::pair<size_t, size_t>> m_pipelineGroups;
+        std::vector<std::vector<NDArrayViewPtr>> m_pipelineGroupChunks;
+        std::vector<std::unique_ptr<Microsoft::MSR::CNTK::MatrixComputeStreamEvent>> m_pipelineEvents;
+        std::vector<size_t> m_pipelineTickets;
+        int m_pipelineDeviceId = CPUDEVICE;
+
+        // Hierarchical block momentum: null if all workers take part in every synchronization. Host buffer of the
+        // exchanges, the number of host averagings and of samples per worker since the last block update.
+        std::unique_ptr<Microsoft::MSR::CNTK::HostGroupExchange> m_hostGroupExchange;
+        size_t m_hostAveragingsPerBlock = 0;
+        size_t m_hostAveragingsInCurrentBlock = 0;
+        size_t m_hierarchicalBlockSamples = 0;
+        std::vector<char> m_hierarchicalBuffer;
+
+        // Piggybacked metrics: sums of the training loss and evaluation criterion of this worker since the last
+        // synchronization, kept on the device of the metrics, and of all workers over the synchronizations since the last report.
+        const bool m_piggybackMetrics;
+        NDArrayViewPtr m_blockMetricSums[2];
+        double m_aggregatedMetrics[2] = { 0, 0 };
+        bool m_hasAggregatedMetrics = false;
+
+        // Significance filtering: the parameters agreed on to aggregate at the last synchronization, the samples per worker
+        // since each parameter was last aggregated, whether m_tempBlockGradient is up to date, and the views aggregated.
+        const double m_significanceThreshold;
+        std::vector<bool> m_parameterSignificant;
+        std::vector<size_t> m_samplesSinceParameterSync;
+        bool m_blockGradientsComputed = false;
+        std::vector<NDArrayViewPtr> m_selectedBlockGradientChunks;
+
+        // Per parameter schedules: the period and phase in blocks and the time constant per worker of every parameter,
+        // empty without schedules, the index of the current block, and whether all parameters are aggregated in it.
+        std::vector<size_t> m_parameterSyncPeriods;
+        std::vector<size_t> m_parameterSyncPhases;
+        std::vector<double> m_parameterTimeConstants;
+        size_t m_blockIndex = 0;
+        bool m_aggregateAllParameters = false;
+
+        // Gossip averaging: null if the block update is global. Round of the next exchange, the same on all
+        // workers, and host buffers of the own and the received previous and current models.
+        std::unique_ptr<Microsoft::MSR::CNTK::GossipExchange> m_gossipExchange;
+        size_t m_gossipRound = 0;
+        std::vector<char> m_gossipBuffer;
+
+        // Declared last, so that an aggregation in flight is finished before the buffers it uses go away.
+        std::unique_ptr<Microsoft::MSR::CNTK::AsyncAggregationEngine> m_asyncAggregationEngine;
+        std::unique_ptr<Microsoft::MSR::CNTK::AsyncAggregationEngine> m_pipelineAggregationEngine;
 
         DISABLE_COPY_AND_MOVE(BlockMomentumDistributedLearner);
      };
@@ -6,6 +6,7 @@
 #pragma  once 
 
 #include "../SGDLib/MASGD.h"
+#include "MPITransfer.h"
 
 
 
@@ -33,6 +34,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         size_t m_syncPeriodPerWorker; 
         map < wstring, shared_ptr<Matrix<ElemType>>>     m_prevParameters;       // parameters at the last model aggregation point
         map < wstring, shared_ptr<Matrix<ElemType>>>    m_blockLevelSmoothedGradient; 
+        vector<ElemType>                                m_fusedBlockGradients;  // block gradients of all nodes, aggregated at once
+        shared_ptr<Matrix<ElemType>>                    m_blockGradientScratch;
 
     public:
         BlockMomentumSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID, 
@@ -120,6 +123,45 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             secondsOnCommunication += (float)commTimer.ElapsedSeconds();
             totalSamplesProcessed = nTotalSamples;
 
+            // 2.1. compute the local block gradients of all nodes into one fused host buffer
+            size_t numElements = 0;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (pBaseNode->IsParameterUpdateRequired())
+                    numElements += DownCast(pBaseNode)->Value().GetNumElements();
+            }
+            if (m_fusedBlockGradients.size() < numElements)
+                m_fusedBlockGradients.resize(numElements);
+
+            size_t offset = 0;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                {
+                    continue;
+                }
+                auto pNode = DownCast(pBaseNode);
+                Matrix<ElemType>& prevWeight = *m_prevParameters[pBaseNode->NodeName()];    // prev model value
+                Matrix<ElemType>& currentWeight = pNode->Value();                              // current model
+                // 2.1.1. subtract it from the previous model, into the scratch matrix which only grows
+                Matrix<ElemType>& blockGrad = BlockGradientScratch(currentWeight.GetDeviceId());
+                blockGrad.AssignDifferenceOf(prevWeight, currentWeight);                        // matW becomes local block gradient (of one worker)
+                // 2.1.2. pack it for sending
+                ElemType* px = m_fusedBlockGradients.data() + offset;
+                size_t nx = blockGrad.GetNumElements();
+                blockGrad.CopyToArray(px, nx);
+                offset += nx;
+            }
+
+            // 2.1.3. send block gradients over MPI nodes; inplace sum, in chunks since MPI counts are ints
+            const size_t maxChunkElements = MaxMessageChunkBytes / sizeof(ElemType);
+            commTimer.Restart();
+            for (size_t chunkOffset = 0; chunkOffset < numElements; chunkOffset += maxChunkElements)
+                m_pMPI->AllReduce(m_fusedBlockGradients.data() + chunkOffset, min(maxChunkElements, numElements - chunkOffset));
+            commTimer.Stop();
+            secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+
+            offset = 0;
             for (auto& pBaseNode : learnableNodes)
             {
                 if (!pBaseNode->IsParameterUpdateRequired())
@@ -127,28 +169,17 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                     continue;
                 }
                 wstring name = pBaseNode->NodeName();
-                // 2 block gradient aggregation 
                 auto pNode = DownCast(pBaseNode);
-                // 2.1. get current model  
                 Matrix<ElemType>& prevWeight = *m_prevParameters[name];               // prev model value 
                 Matrix<ElemType>& currentWeight = pNode->Value();                        // current model 
-                // 2.1.2. subtract it from the previous model                   
-                Matrix<ElemType>  blockGrad(prevWeight.DeepClone());            
-                blockGrad -= currentWeight;                                              // matW becomes local block gradient (of one worker)
-                // 2.1.3. send block gradient over MPI nodes; 
-                unique_ptr<ElemType[]> px(blockGrad.CopyToArray());
-                size_t    nx = blockGrad.GetNumElements();
-                // 2.1.4. inplace sum 
-                commTimer.Restart();
-                m_pMPI->AllReduce(px.get(), nx);
-                commTimer.Stop();
-                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
-                // 2.1.5. global block gradient
-                blockGrad.SetValue(blockGrad.GetNumRows(),
-                                   blockGrad.GetNumCols(),
-                                   blockGrad.GetDeviceId(),
-                                   px.get()
+                // 2.1.4. global block gradient
+                Matrix<ElemType>& blockGrad = BlockGradientScratch(currentWeight.GetDeviceId());
+                blockGrad.SetValue(currentWeight.GetNumRows(),
+                                   currentWeight.GetNumCols(),
+                                   currentWeight.GetDeviceId(),
+                                   m_fusedBlockGradients.data() + offset
                                    ); 
+                offset += currentWeight.GetNumElements();
                 // 2.2. model update 
                 {
                     // alias for better readability 
@@ -238,6 +269,15 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             }
         }
     private:
+       // Scratch matrix for the block gradient of one node at a time. Its buffer only grows, so after the
+       // first sync no memory is allocated.
+       Matrix<ElemType>& BlockGradientScratch(DEVICEID_TYPE deviceId)
+       {
+           if (!m_blockGradientScratch || m_blockGradientScratch->GetDeviceId() != deviceId)
+               m_blockGradientScratch = make_shared<Matrix<ElemType>>(deviceId);
+           return *m_blockGradientScratch;
+       }
+
        // helper function to save/load map<wstring, shared_ptr<Matrix<ElemType>> structure 
        void SaveParameters(File& f, const map<wstring, shared_ptr<Matrix<ElemType>>>& parameters) const
         {
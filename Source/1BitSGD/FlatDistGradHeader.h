@@ -0,0 +1,51 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DistGradHeader.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// FlatDistGradHeader -- a DistGradHeader flattened into doubles, so that the
+// headers of all workers can be summed with a single (nonblocking) allreduce.
+// Layout: criterion, numSamples, numSamplesWithLabel and a pair of values per eval node.
+// =======================================================================
+
+struct FlatDistGradHeader
+{
+    static size_t NumElements(int numEvalNodes)
+    {
+        return 1 + 1 + 1 + numEvalNodes * 2;
+    }
+
+    // 'buffer' has to hold NumElements(header.numEvalNode) values.
+    static void Flatten(const DistGradHeader& header, double* buffer)
+    {
+        buffer[0] = header.criterion;
+        buffer[1] = static_cast<double>(header.numSamples);
+        buffer[2] = static_cast<double>(header.numSamplesWithLabel);
+        for (size_t i = 0; i < header.numEvalNode; ++i)
+        {
+            buffer[3 + 2 * i] = header.evalErrors[i].first;
+            buffer[3 + 2 * i + 1] = static_cast<double>(header.evalErrors[i].second);
+        }
+    }
+
+    static void Unflatten(const double* buffer, DistGradHeader& header)
+    {
+        header.criterion = buffer[0];
+        header.numSamples = static_cast<size_t>(buffer[1]);
+        header.numSamplesWithLabel = static_cast<size_t>(buffer[2]);
+        for (size_t i = 0; i < header.numEvalNode; ++i)
+        {
+            header.evalErrors[i].first = buffer[3 + 2 * i];
+            header.evalErrors[i].second = static_cast<size_t>(buffer[3 + 2 * i + 1]);
+        }
+    }
+};
+
+} } }
@@ -0,0 +1,92 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "MPIWrapper.h"
+#include "MPITransfer.h"
+#include <vector>
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+enum class GossipTopology : int
+{
+    None,         // No gossip, all ranks aggregate together
+    Ring,         // Every rank exchanges with its neighbors on the ring
+    Exponential   // Rank r exchanges with the ranks 2^k away, k rotating from round to round
+};
+
+// =======================================================================
+// GossipExchange -- pairwise model exchange for decentralized averaging.
+// In every round a rank sends its buffer to one peer and receives the buffer of
+// another, such that every rank sends and receives exactly once: averaging the
+// own and the received buffer then keeps the mean over all ranks. Peers follow a
+// topology that rotates from round to round, so information spreads over all ranks
+// in O(log N) rounds with the exponential graph, while the traffic per rank and
+// round is one buffer each way regardless of the number of ranks.
+// All ranks have to run the same rounds in the same order.
+// =======================================================================
+
+class GossipExchange
+{
+public:
+    GossipExchange(MPIWrapper& mpi, GossipTopology topology)
+        : m_mpi(mpi), m_topology(topology), m_rank((int)mpi.CurrentNodeRank()), m_numRanks((int)mpi.NumNodesInUse())
+    {
+        if (topology == GossipTopology::None)
+            InvalidArgument("GossipExchange: a gossip topology is required.");
+
+        for (int distance = 1; distance < m_numRanks; distance *= 2)
+            m_exponentialDistances.push_back(distance);
+    }
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(GossipExchange);
+
+    // Distance to the peer this rank sends to in the given round; it receives from the rank as far away in the other direction.
+    int PeerDistance(size_t round) const
+    {
+        if (m_numRanks == 1)
+            return 0;
+
+        if (m_topology == GossipTopology::Ring)
+            return (round % 2 == 0) ? 1 : (m_numRanks - 1);
+
+        return m_exponentialDistances[round % m_exponentialDistances.size()];
+    }
+
+    // Sends 'send' to the peer of this round and receives the buffer of the opposite peer into 'received'.
+    // A single rank is its own peer and receives its own buffer.
+    template <class ElemType>
+    void Exchange(size_t round, const ElemType* send, ElemType* received, size_t numElements)
+    {
+        int distance = PeerDistance(round);
+        if (distance == 0)
+        {
+            if (received != send)
+                std::copy(send, send + numElements, received);
+            return;
+        }
+
+        const int tag = MessageTag(round);
+        const size_t numBytes = numElements * sizeof(ElemType);
+        IrecvChunked(m_mpi, received, numBytes, (m_rank + m_numRanks - distance) % m_numRanks, tag, m_requests);
+        IsendChunked(m_mpi, send, numBytes, (m_rank + distance) % m_numRanks, tag, m_requests);
+        m_mpi.Waitall((int)m_requests.size(), m_requests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        m_requests.clear();
+    }
+
+private:
+    MPIWrapper& m_mpi;
+    const GossipTopology m_topology;
+    const int m_rank;
+    const int m_numRanks;
+    std::vector<int> m_exponentialDistances;
+    std::vector<MPI_Request> m_requests;
+};
+
+} } }
@@ -0,0 +1,183 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "MPIWrapper.h"
+#include "MPITransfer.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// HostGroupExchange -- two-level exchange of host buffers among the ranks of a job.
+// Ranks are grouped by host and the lowest rank of a host is its leader. Within a
+// host, buffers are summed on the leader and broadcast from it; across hosts, only
+// the leaders take part, summing their buffers with a ring all-reduce. All transfers
+// are point-to-point, so the traffic between hosts does not grow with the number of
+// ranks per host. Every method has to be called by all ranks it involves, in the
+// same order, and not concurrently with other MPI traffic of this object.
+// =======================================================================
+
+class HostGroupExchange
+{
+public:
+    // 'hostOfRank' identifies the host of every rank of 'mpi'.
+    HostGroupExchange(MPIWrapper& mpi, const std::vector<std::wstring>& hostOfRank)
+        : m_mpi(mpi), m_rank((int)mpi.CurrentNodeRank())
+    {
+        if (hostOfRank.size() != mpi.NumNodesInUse())
+            InvalidArgument("HostGroupExchange: expected the host of %d ranks, got %d.", (int)mpi.NumNodesInUse(), (int)hostOfRank.size());
+
+        for (int rank = 0; rank < (int)hostOfRank.size(); ++rank)
+        {
+            if (hostOfRank[rank] == hostOfRank[m_rank])
+                m_hostRanks.push_back(rank);
+
+            // Ranks are visited in increasing order, so the first rank seen on a host is its leader.
+            if (std::find(hostOfRank.begin(), hostOfRank.begin() + rank, hostOfRank[rank]) == hostOfRank.begin() + rank)
+                m_leaders.push_back(rank);
+        }
+
+        m_leaderIndex = (int)(std::find(m_leaders.begin(), m_leaders.end(), m_hostRanks.front()) - m_leaders.begin());
+    }
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(HostGroupExchange);
+
+    bool IsLeader() const { return m_rank == m_hostRanks.front(); }
+    size_t NumHostRanks() const { return m_hostRanks.size(); }
+    size_t NumHosts() const { return m_leaders.size(); }
+
+    // Sums 'data' over the ranks of this host into the buffer of the leader. The buffers of the other ranks are left unchanged.
+    template <class ElemType>
+    void SumToLeader(ElemType* data, size_t numElements)
+    {
+        if (m_hostRanks.size() == 1)
+            return;
+
+        const size_t numBytes = numElements * sizeof(ElemType);
+        if (!IsLeader())
+        {
+            IsendChunked(m_mpi, data, numBytes, m_hostRanks.front(), HostMessageTag, m_requests);
+            WaitForRequests();
+            return;
+        }
+
+        // The contribution of the next rank is received while the previous one is accumulated.
+        m_scratch.resize(2 * numBytes);
+        ElemType* received[2] = { reinterpret_cast<ElemType*>(m_scratch.data()), reinterpret_cast<ElemType*>(m_scratch.data() + numBytes) };
+        std::vector<MPI_Request> pending[2];
+        IrecvChunked(m_mpi, received[0], numBytes, m_hostRanks[1], HostMessageTag, pending[0]);
+        for (size_t i = 1; i < m_hostRanks.size(); ++i)
+        {
+            std::vector<MPI_Request>& current = pending[(i - 1) % 2];
+            if (i + 1 < m_hostRanks.size())
+                IrecvChunked(m_mpi, received[i % 2], numBytes, m_hostRanks[i + 1], HostMessageTag, pending[i % 2]);
+
+            m_mpi.Waitall((int)current.size(), current.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+            current.clear();
+            Accumulate(data, received[(i - 1) % 2], numElements);
+        }
+    }
+
+    // Copies the buffer of the leader to all other ranks of this host.
+    template <class ElemType>
+    void BroadcastFromLeader(ElemType* data, size_t numElements)
+    {
+        if (m_hostRanks.size() == 1)
+            return;
+
+        const size_t numBytes = numElements * sizeof(ElemType);
+        if (IsLeader())
+        {
+            for (size_t i = 1; i < m_hostRanks.size(); ++i)
+                IsendChunked(m_mpi, data, numBytes, m_hostRanks[i], HostMessageTag, m_requests);
+        }
+        else
+        {
+            IrecvChunked(m_mpi, data, numBytes, m_hostRanks.front(), HostMessageTag, m_requests);
+        }
+
+        WaitForRequests();
+    }
+
+    // Sums 'data' over the leaders of all hosts, in place. Only called by leaders.
+    // Ring all-reduce: every leader sends and receives about twice the buffer, independent of the number of hosts.
+    template <class ElemType>
+    void SumOverLeaders(ElemType* data, size_t numElements)
+    {
+        if (!IsLeader())
+            LogicError("HostGroupExchange: only host leaders take part in the exchange across hosts.");
+
+        const int numHosts = (int)m_leaders.size();
+        if (numHosts == 1)
+            return;
+
+        const int next = m_leaders[(m_leaderIndex + 1) % numHosts];
+        const int previous = m_leaders[(m_leaderIndex + numHosts - 1) % numHosts];
+        auto segmentBegin = [numElements, numHosts](int segment) { return numElements * (size_t)segment / numHosts; };
+        auto segmentSize = [&segmentBegin](int segment) { return segmentBegin(segment + 1) - segmentBegin(segment); };
+        auto wrap = [numHosts](int segment) { return ((segment % numHosts) + numHosts) % numHosts; };
+
+        m_scratch.resize((numElements / numHosts + 1) * sizeof(ElemType));
+        ElemType* received = reinterpret_cast<ElemType*>(m_scratch.data());
+
+        // Reduce-scatter: afterwards this leader holds the sum of segment m_leaderIndex + 1.
+        for (int step = 0; step < numHosts - 1; ++step)
+        {
+            int sendSegment = wrap(m_leaderIndex - step);
+            int recvSegment = wrap(m_leaderIndex - step - 1);
+            IsendChunked(m_mpi, data + segmentBegin(sendSegment), segmentSize(sendSegment) * sizeof(ElemType), next, LeaderMessageTag, m_requests);
+            IrecvChunked(m_mpi, received, segmentSize(recvSegment) * sizeof(ElemType), previous, LeaderMessageTag, m_requests);
+            WaitForRequests();
+            Accumulate(data + segmentBegin(recvSegment), received, segmentSize(recvSegment));
+        }
+
+        // Allgather of the summed segments.
+        for (int step = 0; step < numHosts - 1; ++step)
+        {
+            int sendSegment = wrap(m_leaderIndex + 1 - step);
+            int recvSegment = wrap(m_leaderIndex - step);
+            IsendChunked(m_mpi, data + segmentBegin(sendSegment), segmentSize(sendSegment) * sizeof(ElemType), next, LeaderMessageTag, m_requests);
+            IrecvChunked(m_mpi, data + segmentBegin(recvSegment), segmentSize(recvSegment) * sizeof(ElemType), previous, LeaderMessageTag, m_requests);
+            WaitForRequests();
+        }
+    }
+
+private:
+    template <class ElemType>
+    static void Accumulate(ElemType* target, const ElemType* source, size_t numElements)
+    {
+        const long long n = (long long)numElements;
+#pragma omp parallel for
+        for (long long k = 0; k < n; ++k)
+            target[k] += source[k];
+    }
+
+    void WaitForRequests()
+    {
+        m_mpi.Waitall((int)m_requests.size(), m_requests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        m_requests.clear();
+    }
+
+    // Reserved tags, see MPITransfer.h.
+    static const int HostMessageTag = FirstReservedMessageTag + 5;
+    static const int LeaderMessageTag = FirstReservedMessageTag + 6;
+
+    MPIWrapper& m_mpi;
+    const int m_rank;
+    std::vector<int> m_hostRanks;   // Ranks on this host in increasing order, the leader first
+    std::vector<int> m_leaders;     // Leader of every host in increasing order
+    int m_leaderIndex;              // Index of the leader of this host in m_leaders
+
+    std::vector<MPI_Request> m_requests;
+    std::vector<char> m_scratch;
+};
+
+} } }
@@ -0,0 +1,311 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "MPIWrapper.h"
+#include <vector>
+#include <functional>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// MPIProgressEngine -- background thread driving nonblocking MPI requests.
+// Many MPI implementations only advance large (rendezvous) messages while the
+// application is inside an MPI call. The engine polls the requests handed to it
+// with MPI_Testsome and invokes a completion callback on its own thread as soon
+// as a request finishes, so incoming data is processed while the caller is
+// blocked elsewhere (e.g. waiting for a quantization to finish).
+//
+// While the engine is alive all MPI calls of its clients must go through Post(),
+// which serializes them with the polling thread. This only requires
+// MPI_THREAD_SERIALIZED from the MPI library. Requests that are not tracked are
+// waited for with WaitForRequests, which does not hold up the polling thread.
+// While nothing completes, the engine backs off between polls.
+// =======================================================================
+
+class MPIProgressEngine
+{
+public:
+    typedef std::function<void()> Callback;
+
+    MPIProgressEngine()
+        : m_stop(false), m_numPending(0)
+    {
+        int provided = MPI_THREAD_SINGLE;
+        MPI_Query_thread(&provided) || MpiFail("MPI_Query_thread");
+        if (provided < MPI_THREAD_SERIALIZED)
+            RuntimeError("The MPI progress thread requires at least MPI_THREAD_SERIALIZED support, the MPI library provides thread level %d.", provided);
+
+        m_thread = std::thread([this] { Run(); });
+    }
+
+    ~MPIProgressEngine()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_workAvailable.notify_all();
+        m_thread.join();
+    }
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(MPIProgressEngine);
+
+    // Issues an MPI call serialized with the polling thread. The polling thread is held up for the duration of
+    // the call, so blocking calls may only be posted while no requests are tracked.
+    template <class Func>
+    void Post(const Func& mpiCall)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        mpiCall();
+    }
+
+    // Hands the request over to the engine. 'onComplete' is called on the engine thread
+    // once the request has finished. The caller must not wait on or test the request anymore.
+    // Callbacks are invoked one at a time, so they do not need to synchronize among each other.
+    void Track(MPI_Request request, Callback onComplete)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_requests.push_back(request);
+            m_callbacks.push_back(std::move(onComplete));
+            m_numPending++;
+            m_requestsAdded = true;
+        }
+
+        m_workAvailable.notify_one();
+    }
+
+    // Waits for requests that are not tracked by the engine. They are tested serialized with the polling thread,
+    // backing off in between, so that neither thread is held up for the duration of the wait.
+    void WaitForRequests(int count, MPI_Request* requests)
+    {
+        std::chrono::microseconds pollInterval(MinPollIntervalUs);
+        for (;;)
+        {
+            int done = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                MPI_Testall(count, requests, &done, MPI_STATUSES_IGNORE) || MpiFail("MPI_Testall");
+            }
+
+            if (done)
+                return;
+
+            std::this_thread::sleep_for(pollInterval);
+            pollInterval = std::min(pollInterval * 2, std::chrono::microseconds(MaxPollIntervalUs));
+        }
+    }
+
+    // Time at which the requests whose callbacks are being invoked were found complete.
+    // Only meaningful when called from a callback.
+    std::chrono::steady_clock::time_point CompletionTime() const
+    {
+        return m_completionTime;
+    }
+
+    // Blocks until all tracked requests have completed and their callbacks have returned.
+    // Rethrows the first error raised on the engine thread.
+    void WaitAll()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_allDone.wait(lock, [this] { return m_numPending == 0; });
+
+        if (m_error)
+        {
+            std::exception_ptr error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Cancels all tracked requests without invoking their callbacks and waits for the callbacks
+    // that are already running to return. Used when the state the callbacks refer to goes away
+    // before the requests completed, e.g. because an exception is thrown. The cancellation is
+    // waited for, so that MPI no longer accesses the buffers of the requests afterwards.
+    void CancelAll()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (auto& request : m_requests)
+        {
+            MPI_Cancel(&request);
+            MPI_Wait(&request, MPI_STATUS_IGNORE);
+        }
+
+        m_numPending -= m_requests.size();
+        m_requests.clear();
+        m_callbacks.clear();
+        m_allDone.wait(lock, [this] { return m_numPending == 0; });
+        m_error = nullptr;
+    }
+
+private:
+    void Run()
+    {
+        std::vector<int> completedIndices;
+        std::vector<Callback> completedCallbacks;
+        std::chrono::microseconds pollInterval(MinPollIntervalUs);
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workAvailable.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+                if (m_stop)
+                    return;
+
+                m_requestsAdded = false;
+
+                completedIndices.resize(m_requests.size());
+                int numCompleted = 0;
+                try
+                {
+                    MPI_Testsome((int)m_requests.size(), m_requests.data(), &numCompleted, completedIndices.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Testsome");
+                }
+                catch (...)
+                {
+                    // Give up on everything that is tracked; the error is reported to the waiter.
+                    FailPending(std::current_exception());
+                    continue;
+                }
+
+                if (numCompleted == MPI_UNDEFINED)
+                    numCompleted = 0;
+
+                if (numCompleted > 0)
+                    m_completionTime = std::chrono::steady_clock::now();
+
+                for (int i = 0; i < numCompleted; ++i)
+                    completedCallbacks.push_back(std::move(m_callbacks[completedIndices[i]]));
+
+                // Completed requests have been set to MPI_REQUEST_NULL by MPI_Testsome, drop them.
+                size_t numRemaining = 0;
+                for (size_t i = 0; i < m_requests.size(); ++i)
+                {
+                    if (m_requests[i] == MPI_REQUEST_NULL)
+                        continue;
+
+                    m_requests[numRemaining] = m_requests[i];
+                    m_callbacks[numRemaining] = std::move(m_callbacks[i]);
+                    numRemaining++;
+                }
+
+                m_requests.resize(numRemaining);
+                m_callbacks.resize(numRemaining);
+            }
+
+            if (completedCallbacks.empty())
+            {
+                // Back off while nothing completes, without holding the lock; newly tracked requests are polled right away.
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workAvailable.wait_for(lock, pollInterval, [this] { return m_stop || m_requestsAdded; });
+                pollInterval = std::min(pollInterval * 2, std::chrono::microseconds(MaxPollIntervalUs));
+                continue;
+            }
+
+            pollInterval = std::chrono::microseconds(MinPollIntervalUs);
+
+            std::exception_ptr error;
+            for (auto& callback : completedCallbacks)
+            {
+                try
+                {
+                    if (!error)
+                        callback();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            size_t numFinished = completedCallbacks.size();
+            completedCallbacks.clear();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (error && !m_error)
+                m_error = error;
+
+            m_numPending -= numFinished;
+            if (m_numPending == 0)
+                m_allDone.notify_all();
+        }
+    }
+
+    // Must be called with m_mutex held.
+    void FailPending(std::exception_ptr error)
+    {
+        if (!m_error)
+            m_error = error;
+
+        m_numPending -= m_requests.size();
+        m_requests.clear();
+        m_callbacks.clear();
+        if (m_numPending == 0)
+            m_allDone.notify_all();
+    }
+
+    // Bounds of the interval between polls while no request completes, in microseconds.
+    static const int MinPollIntervalUs = 5;
+    static const int MaxPollIntervalUs = 200;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_allDone;
+    bool m_stop;
+
+    // Whether requests have been tracked since the last poll.
+    bool m_requestsAdded = false;
+
+    // Requests currently polled by the engine and their completion callbacks.
+    std::vector<MPI_Request> m_requests;
+    std::vector<Callback> m_callbacks;
+
+    // Number of tracked requests whose callbacks have not returned yet.
+    size_t m_numPending;
+
+    std::exception_ptr m_error;
+
+    // Time the last completed requests were found complete, only accessed by the engine thread.
+    std::chrono::steady_clock::time_point m_completionTime;
+};
+
+// =======================================================================
+// ScopedTrackedRequests -- cancels the requests still tracked by an engine when
+// leaving a scope, so that no callback capturing locals of the scope runs after
+// they are gone. A no-op if all requests completed or there is no engine.
+// =======================================================================
+
+class ScopedTrackedRequests
+{
+public:
+    explicit ScopedTrackedRequests(MPIProgressEngine* engine)
+        : m_engine(engine)
+    {}
+
+    ~ScopedTrackedRequests()
+    {
+        if (m_engine)
+            m_engine->CancelAll();
+    }
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(ScopedTrackedRequests);
+
+private:
+    MPIProgressEngine* m_engine;
+};
+
+} } }
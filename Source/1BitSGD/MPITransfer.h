@@ -0,0 +1,71 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "MPIWrapper.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// Helpers for point-to-point transfers of buffers of arbitrary (64-bit) size.
+// MPI counts are ints, so buffers larger than MaxMessageChunkBytes are split
+// into consecutive chunks that are all sent with the same tag. Messages between
+// the same pair of ranks with the same tag are non-overtaking, hence the chunks
+// are matched in order as long as the receiver posts them in order as well.
+// =======================================================================
+
+// Largest number of bytes moved by a single MPI message.
+static const size_t MaxMessageChunkBytes = (size_t)1 << 30;
+
+// Number of messages needed to transfer 'numBytes'. An empty buffer still takes one (empty) message.
+inline size_t NumMessageChunks(size_t numBytes)
+{
+    return (numBytes == 0) ? 1 : ((numBytes + MaxMessageChunkBytes - 1) / MaxMessageChunkBytes);
+}
+
+// Posts the sends for 'numBytes' bytes starting at 'buffer' and appends one request per chunk to 'requests'.
+inline void IsendChunked(MPIWrapper& mpi, const void* buffer, size_t numBytes, int dest, int tag, std::vector<MPI_Request>& requests)
+{
+    const char* data = static_cast<const char*>(buffer);
+    size_t numChunks = NumMessageChunks(numBytes);
+    for (size_t chunk = 0; chunk < numChunks; ++chunk)
+    {
+        size_t offset = chunk * MaxMessageChunkBytes;
+        size_t chunkBytes = min(MaxMessageChunkBytes, numBytes - offset);
+        requests.push_back(MPI_Request());
+        mpi.Isend(data + offset, (int)chunkBytes, MPI_CHAR, dest, tag, &requests.back()) || MpiFail("MPI_Isend");
+    }
+}
+
+// Posts the receives for 'numBytes' bytes into 'buffer' and appends one request per chunk to 'requests'.
+inline void IrecvChunked(MPIWrapper& mpi, void* buffer, size_t numBytes, int source, int tag, std::vector<MPI_Request>& requests)
+{
+    char* data = static_cast<char*>(buffer);
+    size_t numChunks = NumMessageChunks(numBytes);
+    for (size_t chunk = 0; chunk < numChunks; ++chunk)
+    {
+        size_t offset = chunk * MaxMessageChunkBytes;
+        size_t chunkBytes = min(MaxMessageChunkBytes, numBytes - offset);
+        requests.push_back(MPI_Request());
+        mpi.Irecv(data + offset, (int)chunkBytes, MPI_CHAR, source, tag, &requests.back()) || MpiFail("MPI_Irecv");
+    }
+}
+
+// The standard only guarantees tags up to 32767. The top ones are reserved for transfers with a fixed tag
+// (e.g. HostGroupExchange, AggregationTracer), all others are available to MessageTag.
+static const int NumReservedMessageTags = 8;
+static const int FirstReservedMessageTag = 32767 - NumReservedMessageTags + 1;
+
+// Maps a logical message id (e.g. derived from a parameter index) to a tag below the reserved ones.
+// Larger ids wrap around, which is safe since messages between a pair of ranks are matched in posting order.
+inline int MessageTag(size_t messageId)
+{
+    return (int)(messageId % (size_t)FirstReservedMessageTag);
+}
+
+} } }
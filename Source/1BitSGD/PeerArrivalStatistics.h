@@ -0,0 +1,221 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Running arrival statistics of a single peer.
+struct PeerArrivalMetrics
+{
+    int m_peer = -1;
+    size_t m_numRounds = 0;         // Exchanges the peer took part in
+    double m_lastLagSeconds = 0;
+    double m_meanLagSeconds = 0;    // Exponentially weighted moving average of the lag
+    double m_maxLagSeconds = 0;
+    size_t m_numLateRounds = 0;
+    size_t m_consecutiveLateRounds = 0;
+    bool m_isStraggler = false;
+};
+
+// =======================================================================
+// PeerArrivalStatistics -- per-peer arrival skew of the stripe exchange.
+// Every exchange is a round in which the stripes of all peers arrive; the lag of
+// a peer is the time between the first peer completing its stripes and the peer
+// itself completing them. A peer is late in a round if its lag exceeds both an
+// absolute minimum and a multiple of the median lag of the round, and it is
+// flagged as a straggler after being late in a number of consecutive rounds.
+// Arrivals may be recorded from a different thread than the one ending the round,
+// as long as the round is ended after the last arrival.
+// =======================================================================
+
+class PeerArrivalStatistics
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // 'smoothing' is the weight of the latest round in the moving average of the lag.
+    PeerArrivalStatistics(double smoothing = 0.1, double lateLagFactor = 2.0, double minLateLagSeconds = 1e-3, size_t stragglerPersistence = 10)
+        : m_smoothing(smoothing), m_lateLagFactor(lateLagFactor), m_minLateLagSeconds(minLateLagSeconds), m_stragglerPersistence(std::max<size_t>(stragglerPersistence, 1)),
+        m_logIntervalSeconds(0), m_lastLog(Clock::now()), m_hasLogged(false)
+    {}
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(PeerArrivalStatistics);
+
+    // Stragglers are reported on stderr at most once per 'intervalSeconds'; 0 disables reporting.
+    void SetLogInterval(double intervalSeconds)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_logIntervalSeconds = intervalSeconds;
+    }
+
+    // Starts a round of an exchange among 'numPeers' ranks.
+    void BeginRound(size_t numPeers)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_metrics.size() != numPeers)
+        {
+            m_metrics.assign(numPeers, PeerArrivalMetrics());
+            for (size_t i = 0; i < numPeers; ++i)
+                m_metrics[i].m_peer = (int)i;
+        }
+
+        m_lastArrival.assign(numPeers, Clock::time_point());
+        m_hasArrived.assign(numPeers, false);
+    }
+
+    // Records the arrival of a stripe from 'peer' at 'arrival', the time its receive was found complete by MPI,
+    // rather than when it got processed; the last stripe of a peer marks its completion.
+    void RecordArrival(int peer, Clock::time_point arrival)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (peer < 0 || (size_t)peer >= m_lastArrival.size())
+            return;
+
+        m_lastArrival[peer] = arrival;
+        m_hasArrived[peer] = true;
+    }
+
+    // Updates the statistics with the lags of the peers that arrived in this round.
+    void EndRound()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Clock::time_point firstCompletion = Clock::time_point::max();
+        for (size_t i = 0; i < m_lastArrival.size(); ++i)
+        {
+            if (m_hasArrived[i])
+                firstCompletion = std::min(firstCompletion, m_lastArrival[i]);
+        }
+
+        if (firstCompletion == Clock::time_point::max())
+            return;
+
+        m_roundLags.clear();
+        for (size_t i = 0; i < m_lastArrival.size(); ++i)
+        {
+            if (m_hasArrived[i])
+                m_roundLags.push_back(std::chrono::duration<double>(m_lastArrival[i] - firstCompletion).count());
+        }
+
+        std::nth_element(m_roundLags.begin(), m_roundLags.begin() + m_roundLags.size() / 2, m_roundLags.end());
+        double medianLagSeconds = m_roundLags[m_roundLags.size() / 2];
+        double lateLagSeconds = std::max(m_minLateLagSeconds, m_lateLagFactor * medianLagSeconds);
+
+        bool newStraggler = false;
+        for (size_t i = 0; i < m_lastArrival.size(); ++i)
+        {
+            if (!m_hasArrived[i])
+                continue;
+
+            auto& metrics = m_metrics[i];
+            double lagSeconds = std::chrono::duration<double>(m_lastArrival[i] - firstCompletion).count();
+            metrics.m_meanLagSeconds = (metrics.m_numRounds == 0) ? lagSeconds : (m_smoothing * lagSeconds + (1 - m_smoothing) * metrics.m_meanLagSeconds);
+            metrics.m_lastLagSeconds = lagSeconds;
+            metrics.m_maxLagSeconds = std::max(metrics.m_maxLagSeconds, lagSeconds);
+            metrics.m_numRounds++;
+
+            if (lagSeconds >= lateLagSeconds)
+            {
+                metrics.m_numLateRounds++;
+                metrics.m_consecutiveLateRounds++;
+            }
+            else
+                metrics.m_consecutiveLateRounds = 0;
+
+            bool isStraggler = (metrics.m_consecutiveLateRounds >= m_stragglerPersistence);
+            newStraggler |= (isStraggler && !metrics.m_isStraggler);
+            metrics.m_isStraggler = isStraggler;
+        }
+
+        LogStragglers(newStraggler);
+    }
+
+    // Snapshot of the statistics of all peers, indexed by rank.
+    std::vector<PeerArrivalMetrics> Metrics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_metrics;
+    }
+
+    // Ranks currently flagged as stragglers.
+    std::vector<int> Stragglers() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<int> stragglers;
+        for (const auto& metrics : m_metrics)
+        {
+            if (metrics.m_isStraggler)
+                stragglers.push_back(metrics.m_peer);
+        }
+
+        return stragglers;
+    }
+
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_metrics.clear();
+        m_lastArrival.clear();
+        m_hasArrived.clear();
+    }
+
+private:
+    // Called with the lock held. A newly flagged straggler is reported right away, others at the log interval.
+    void LogStragglers(bool newStraggler)
+    {
+        if (m_logIntervalSeconds <= 0)
+            return;
+
+        Clock::time_point now = Clock::now();
+        if (!newStraggler && m_hasLogged && (std::chrono::duration<double>(now - m_lastLog).count() < m_logIntervalSeconds))
+            return;
+
+        bool logged = false;
+        for (const auto& metrics : m_metrics)
+        {
+            if (!metrics.m_isStraggler)
+                continue;
+
+            fprintf(stderr, "WARNING: Rank %d is a persistent straggler in gradient aggregation: mean arrival lag %.3g ms, late in %d of %d exchanges.\n",
+                    metrics.m_peer, metrics.m_meanLagSeconds * 1e3, (int)metrics.m_numLateRounds, (int)metrics.m_numRounds);
+            logged = true;
+        }
+
+        if (logged)
+        {
+            fflush(stderr);
+            m_lastLog = now;
+            m_hasLogged = true;
+        }
+    }
+
+    const double m_smoothing;
+    const double m_lateLagFactor;
+    const double m_minLateLagSeconds;
+    const size_t m_stragglerPersistence;
+    double m_logIntervalSeconds;
+
+    mutable std::mutex m_mutex;
+    std::vector<PeerArrivalMetrics> m_metrics;
+
+    // State of the current round
+    std::vector<Clock::time_point> m_lastArrival;
+    std::vector<bool> m_hasArrived;
+    std::vector<double> m_roundLags;
+
+    Clock::time_point m_lastLog;
+    bool m_hasLogged;
+};
+
+} } }
@@ -9,20 +9,69 @@
 #include "CNTKLibrary.h"
 #include "DistributedLearnerBase.h"
 #include "PerformanceProfiler.h"
+#include "QuantizedDistributedCommunicator.h"
 
 namespace CNTK
 {
+    ///
+    /// Additional options of the quantized distributed trainer.
+    ///
+    struct QuantizedDataParallelAdditionalOptions
+    {
+        // Progress the stripe exchanges of the quantized aggregation on a background thread, which unquantizes received
+        // stripes as soon as they arrive. Requires the quantized MPI communicator and an MPI library with at least
+        // MPI_THREAD_SERIALIZED support.
+        bool useProgressThread = false;
+
+        // Aggregate each gradient on a background thread as soon as it is reported through OnGradientReady, overlapping
+        // the aggregation with the rest of the backpropagation. Requires the quantized MPI communicator and an MPI library
+        // with at least MPI_THREAD_SERIALIZED support. All workers have to use the same setting.
+        bool useStreamedAggregation = false;
+    };
+
     ///
     /// Quantized Distributed Trainer.
     ///
     class QuantizedDataParallelDistributedLearner : public DistributedLearnerBase
     {
     public:
-        QuantizedDataParallelDistributedLearner(QuantizedDistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributeAfterSamples, bool useAsyncBufferedParameterUpdate)
-            : DistributedLearnerBase(communicator, learner, distributeAfterSamples)
+        QuantizedDataParallelDistributedLearner(QuantizedDistributedCommunicatorPtr communicator, LearnerPtr learner, size_t distributeAfterSamples, bool useAsyncBufferedParameterUpdate,
+                                                const QuantizedDataParallelAdditionalOptions& additionalOptions = QuantizedDataParallelAdditionalOptions())
+            : DistributedLearnerBase(communicator, learner, distributeAfterSamples),
+            m_useStreamedAggregation(additionalOptions.useStreamedAggregation)
         {
             if (useAsyncBufferedParameterUpdate)
                 LogicError("Asynchronous parameter update is not yet supported.");
+
+            auto mpiCommunicator = dynamic_cast<QuantizedMPICommunicatorImpl*>(communicator.get());
+            if (additionalOptions.useProgressThread)
+            {
+                if (!mpiCommunicator)
+                    InvalidArgument("The MPI progress thread requires the quantized MPI communicator.");
+
+                mpiCommunicator->EnableProgressThread();
+            }
+
+            if (m_useStreamedAggregation && !mpiCommunicator)
+                InvalidArgument("Streamed gradient aggregation requires the quantized MPI communicator.");
+        }
+
+        // Optionally called during backpropagation as soon as the gradient of a parameter has been computed.
+        // With streamed aggregation, the gradient is handed over to the communicator right away, so its aggregation
+        // overlaps with the backpropagation of the remaining layers; Update then hands over the gradients not reported
+        // here and waits for the ones still in flight. Without it, gradients are aggregated in Update and this is a no-op.
+        // This is the entry point for the training loop, which calls it from its backpropagation.
+        void OnGradientReady(const Parameter& parameter, const NDArrayViewPtr& gradient)
+        {
+            if (!m_useStreamedAggregation || m_sampleCount < m_distributeAfterSamples)
+                return;
+
+            auto index = ParameterIndices().find(parameter);
+            if (index == m_parameterIndices.end())
+                LogicError("Gradient reported for a parameter that is not learned by this learner.");
+
+            BeginStreamedAggregationIfNeeded();
+            StreamingCommunicator()->SubmitForAggregation(index->second, gradient);
         }
 
         // Optional override that gets called per minibatch after finishing gradient computation but before updating model parameters
@@ -31,12 +80,28 @@ namespace CNTK
             if (m_sampleCount >= m_distributeAfterSamples)
             {
                 auto profGradientAgg = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainGradient);
+                auto& aggregationProfiler = Microsoft::MSR::CNTK::AggregationProfiler::Get();
+                aggregationProfiler.BeginIteration();
+                long long aggregationBeginNs = aggregationProfiler.Now();
 
                 if (info.IsEmpty())
                     PrepaireZeroGradients(gradientValues);
 
                 ConvertToOrdered(gradientValues, m_gradientBuffer);
 
+                // Every worker streams in every iteration, also if none of its gradients has been reported during
+                // backpropagation (e.g. on an empty minibatch), so that all workers issue the same collectives in the
+                // same order. The streamed aggregation has to end before the header aggregation, since it owns the
+                // communicator until then.
+                if (m_useStreamedAggregation)
+                    EndStreamedAggregation();
+
+                if (!m_aggregationPrioritiesSet)
+                {
+                    SetAggregationPriorities();
+                    m_aggregationPrioritiesSet = true;
+                }
+
                 std::vector<NDArrayViewPtr> headerToAggregate;
                 headerToAggregate.push_back(info.evalCriterionValue);
                 headerToAggregate.push_back(info.trainingLossValue);
@@ -44,7 +109,9 @@ namespace CNTK
                 auto value = MakeSharedObject<NDArrayView>(static_cast<double>(info.numberOfSamples), NDShape{ 1 }, DeviceDescriptor::CPUDevice());
                 headerToAggregate.push_back(value);
 
+                long long headerBeginNs = aggregationProfiler.Now();
                 m_communicator->AggregateInPlace(headerToAggregate, m_communicator->Workers());
+                aggregationProfiler.Record(Microsoft::MSR::CNTK::AggregationPhase::Header, -1, headerBeginNs, aggregationProfiler.Now());
 
                 info.numberOfSamples = static_cast<size_t>(*headerToAggregate.back()->DataBuffer<double>());
 
@@ -53,11 +120,16 @@ namespace CNTK
                     gradients.push_back(i.second);
                 m_gradientBuffer.clear();
 
-                dynamic_cast<QuantizedDistributedCommunicator*>(m_communicator.get())->QuantizedAggregateInPlace(
-                    gradients,
-                    m_residuals,
-                    m_stripeResiduals,
-                    m_communicator->Workers());
+                if (!m_useStreamedAggregation)
+                {
+                    dynamic_cast<QuantizedDistributedCommunicator*>(m_communicator.get())->QuantizedAggregateInPlace(
+                        gradients,
+                        m_residuals,
+                        m_stripeResiduals,
+                        m_communicator->Workers());
+                }
+
+                aggregationProfiler.Record(Microsoft::MSR::CNTK::AggregationPhase::Total, -1, aggregationBeginNs, aggregationProfiler.Now());
             }
 
             auto profWeights = Microsoft::MSR::CNTK::ScopeProfile(Microsoft::MSR::CNTK::profilerEvtMainWeights);
@@ -75,10 +147,11 @@ namespace CNTK
             // Resetting the residuals.
             // We do this to make sure that the returned checkpoint state is consistent with the in - memory state, since we do not checkpoint the residues.
             for (size_t i = 0; i < m_residuals.size(); ++i)
-                if (m_residuals[i]->GetDataType() == DataType::Double)
-                    m_residuals[i]->SetValue(0.0);
-                else
-                    m_residuals[i]->SetValue(0.0f);
+                if (m_residuals[i])
+                    if (m_residuals[i]->GetDataType() == DataType::Double)
+                        m_residuals[i]->SetValue(0.0);
+                    else
+                        m_residuals[i]->SetValue(0.0f);
 
             for (size_t i = 0; i < m_stripeResiduals.size(); ++i)
                 if (m_stripeResiduals[i])
@@ -91,9 +164,90 @@ namespace CNTK
         }
 
     private:
+        // Lets the communicator process the gradients of the first layers first, since the next forward pass needs them first.
+        // The parameters of the learner are listed from the output of the model towards its inputs, i.e. in backpropagation order.
+        // Has to be called by all workers at the same point, while no streamed aggregation is in flight.
+        void SetAggregationPriorities()
+        {
+            auto communicator = dynamic_cast<QuantizedMPICommunicatorImpl*>(m_communicator.get());
+            if (!communicator)
+                return;
+
+            std::vector<Parameter> parameters = m_learner->Parameters();
+            std::unordered_map<Parameter, int> priorities;
+            for (size_t i = 0; i < parameters.size(); ++i)
+                priorities[parameters[i]] = (int)(parameters.size() - 1 - i);
+
+            // Gradients are aggregated in the order of ConvertToOrdered, i.e. sorted by parameter uid.
+            std::sort(parameters.begin(), parameters.end(), [](const Parameter& a, const Parameter& b) { return a.Uid() < b.Uid(); });
+            std::vector<int> orderedPriorities;
+            for (const auto& parameter : parameters)
+                orderedPriorities.push_back(priorities.at(parameter));
+
+            communicator->SetAggregationPriorities(orderedPriorities);
+        }
+
+        QuantizedMPICommunicatorImpl* StreamingCommunicator() const
+        {
+            return static_cast<QuantizedMPICommunicatorImpl*>(m_communicator.get());
+        }
+
+        // Position of each parameter in the aggregation order of ConvertToOrdered, i.e. sorted by parameter uid.
+        const std::unordered_map<Parameter, size_t>& ParameterIndices()
+        {
+            if (m_parameterIndices.empty())
+            {
+                std::vector<Parameter> parameters = m_learner->Parameters();
+                std::sort(parameters.begin(), parameters.end(), [](const Parameter& a, const Parameter& b) { return a.Uid() < b.Uid(); });
+                for (size_t i = 0; i < parameters.size(); ++i)
+                    m_parameterIndices[parameters[i]] = i;
+            }
+
+            return m_parameterIndices;
+        }
+
+        void BeginStreamedAggregationIfNeeded()
+        {
+            if (m_streamingStarted)
+                return;
+
+            StreamingCommunicator()->BeginStreamedAggregation(ParameterIndices().size(), m_residuals, m_stripeResiduals);
+            m_streamingStarted = true;
+        }
+
+        // Hands over the gradients that have not been reported during backpropagation and waits for all of them.
+        void EndStreamedAggregation()
+        {
+            if (m_gradientBuffer.size() != ParameterIndices().size())
+                LogicError("Streamed aggregation requires gradients for all parameters of the learner.");
+
+            BeginStreamedAggregationIfNeeded();
+            m_streamingStarted = false;
+
+            auto communicator = StreamingCommunicator();
+            for (size_t i = 0; i < m_gradientBuffer.size(); ++i)
+            {
+                if (m_parameterIndices.at(m_gradientBuffer[i].first) != i)
+                    LogicError("Unexpected order of gradients in streamed aggregation.");
+
+                if (!communicator->IsSubmittedForAggregation(i))
+                    communicator->SubmitForAggregation(i, m_gradientBuffer[i].second);
+            }
+
+            communicator->EndStreamedAggregation();
+        }
+
         // Residuals of quantized gradients.
         std::vector<NDArrayViewPtr> m_residuals;
         // Residuals of quantized aggregated stripes this node is responsible for.
         std::vector<NDArrayViewPtr> m_stripeResiduals;
+
+        // Streamed aggregation: the position of each parameter in the aggregation order, see ParameterIndices.
+        const bool m_useStreamedAggregation;
+        std::unordered_map<Parameter, size_t> m_parameterIndices;
+        // Whether gradients of the current minibatch are being streamed to the communicator.
+        bool m_streamingStarted = false;
+        // Whether the communicator has been told the aggregation priorities of the gradients.
+        bool m_aggregationPrioritiesSet = false;
     };
 }
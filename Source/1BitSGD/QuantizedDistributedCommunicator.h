@@ -13,6 +13,16 @@
 #include "CUDAPageLockedMemAllocator.h"
 #include "Utils.h"
 #include "DistributedCommunicator.h"
+#include "MPIProgressEngine.h"
+#include "MPITransfer.h"
+#include "AggregationProfiler.h"
+#include "AggregationTrace.h"
+#include "PeerArrivalStatistics.h"
+#include <numeric>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
     class MatrixQuantizerBase;
@@ -42,12 +52,29 @@ namespace CNTK
         template<class T> using MatrixQuantizer = Microsoft::MSR::CNTK::MatrixQuantizer<T>;
         template<class T> using QuantizedMatrix = Microsoft::MSR::CNTK::QuantizedMatrix<T>;
         template<class T> using Matrix = Microsoft::MSR::CNTK::Matrix<T>;
+        using MPIProgressEngine = Microsoft::MSR::CNTK::MPIProgressEngine;
+        using ScopedTrackedRequests = Microsoft::MSR::CNTK::ScopedTrackedRequests;
+        using MatrixComputeStreamEvent = Microsoft::MSR::CNTK::MatrixComputeStreamEvent;
+        using AggregationProfiler = Microsoft::MSR::CNTK::AggregationProfiler;
+        using AggregationPhase = Microsoft::MSR::CNTK::AggregationPhase;
+        using ScopedAggregationPhase = Microsoft::MSR::CNTK::ScopedAggregationPhase;
+        using AggregationTracer = Microsoft::MSR::CNTK::AggregationTracer;
+        using PeerArrivalStatistics = Microsoft::MSR::CNTK::PeerArrivalStatistics;
 
     public:
         QuantizedMPICommunicatorImpl(bool zeroThresholdFor1Bit, bool useQuantizationForSelfStripe, size_t numQuantizationBits)
             : m_zeroThresholdFor1Bit(zeroThresholdFor1Bit), m_useQuantizationForSelfStripe(useQuantizationForSelfStripe), m_numQuantizationBits(numQuantizationBits)
         {}
 
+        // Lets a background thread progress the stripe exchanges of QuantizedAggregate and unquantize received stripes
+        // as soon as they arrive, see MPIProgressEngine. Has to be called while no aggregation is in flight.
+        void EnableProgressThread()
+        {
+            // The progress thread only pays off when there is someone to talk to.
+            if (!m_progressEngine && Workers().size() > 1)
+                m_progressEngine.reset(new MPIProgressEngine());
+        }
+
         void QuantizedAggregateInPlace(
             std::vector<NDArrayViewPtr>& inValues,
             std::vector<NDArrayViewPtr>& valueQuantizationResidues,
@@ -91,13 +118,159 @@ namespace CNTK
             }
 
             if (dataType == DataType::Float)
-                QuantizedAggregate<float>(inValues, valueQuantizationResidues, stripeQuantizationResidues, aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, sendToWorkers);
+                QuantizedAggregate<float>(m_buffers, inValues, valueQuantizationResidues, stripeQuantizationResidues, aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, sendToWorkers);
             else if (dataType == DataType::Double)
-                QuantizedAggregate<double>(inValues, valueQuantizationResidues, stripeQuantizationResidues, aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, sendToWorkers);
+                QuantizedAggregate<double>(m_buffers, inValues, valueQuantizationResidues, stripeQuantizationResidues, aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, sendToWorkers);
             else
                 LogicError("Unexpected type value.");
         }
 
+        // Sets the priorities of the values passed to QuantizedAggregate: values with a lower priority are quantized,
+        // sent and unquantized first. Typically the parameters of the first layers get the lowest priority, since
+        // they are needed first by the next forward pass. Priorities only take effect if there is one per value;
+        // an empty vector restores the input order.
+        // Collective: values whose message tags wrap onto each other are matched in the order they are sent, so all
+        // workers have to use the same priorities, which is verified here.
+        void SetAggregationPriorities(const vector<int>& priorities)
+        {
+            if (Workers().size() > 1)
+            {
+                size_t checksum = priorities.size();
+                for (int priority : priorities)
+                    checksum = checksum * 1000003 + (unsigned int)priority;
+
+                // The minimum and the maximum over all workers only agree with the local checksum if all checksums are equal.
+                size_t minChecksum = checksum;
+                size_t negatedMaxChecksum = ~checksum;
+                MpiCall([&]
+                {
+                    m_mpi->AllReduce(&minChecksum, 1, MPI_MIN);
+                    m_mpi->AllReduce(&negatedMaxChecksum, 1, MPI_MIN);
+                });
+
+                if (minChecksum != checksum || negatedMaxChecksum != ~checksum)
+                    InvalidArgument("All workers have to use the same aggregation priorities.");
+            }
+
+            m_aggregationPriorities = priorities;
+        }
+
+        // Streamed aggregation: instead of handing all values over at once after backpropagation finished,
+        // each value is submitted as soon as it has been computed and aggregated on a background thread
+        // while the remaining ones are still being computed. Values are aggregated one at a time in the
+        // order of their indices, whatever order they are submitted in, so all workers agree on it even if
+        // some of them only submit all values at the end. Submitting a value early lets its aggregation start
+        // as soon as all values with a lower index have been aggregated.
+        // No other collective may be issued on this communicator until EndStreamedAggregation returns.
+        // Values are aggregated on a background thread, so MPI has to support at least MPI_THREAD_SERIALIZED.
+        void BeginStreamedAggregation(
+            size_t numValues,
+            vector<NDArrayViewPtr>& valueQuantizationResidues,
+            vector<NDArrayViewPtr>& stripeQuantizationResidues)
+        {
+            if (m_streamingActive)
+                LogicError("Streamed aggregation has already been started.");
+
+            if (!m_streamWorker.joinable() && Workers().size() > 1)
+            {
+                int provided = MPI_THREAD_SINGLE;
+                MPI_Query_thread(&provided) || MpiFail("MPI_Query_thread");
+                if (provided < MPI_THREAD_SERIALIZED)
+                    RuntimeError("Streamed aggregation requires at least MPI_THREAD_SERIALIZED support, the MPI library provides thread level %d.", provided);
+            }
+
+            if (valueQuantizationResidues.empty())
+                valueQuantizationResidues.resize(numValues);
+            if (stripeQuantizationResidues.empty())
+                stripeQuantizationResidues.resize(numValues);
+            if (valueQuantizationResidues.size() != numValues || stripeQuantizationResidues.size() != numValues)
+                LogicError("Number of streamed values should be equal number of quantized residuals.");
+
+            std::lock_guard<std::mutex> lock(m_streamMutex);
+            m_streamValues.assign(numValues, nullptr);
+            m_streamMainStreamEvents.resize(numValues);
+            m_streamAggregated.assign(numValues, false);
+            m_streamBuffers.resize(numValues);
+            m_streamNextIndex = 0;
+            m_streamResidues = &valueQuantizationResidues;
+            m_streamStripeResidues = &stripeQuantizationResidues;
+            m_streamError = nullptr;
+            m_streamingActive = true;
+
+            if (!m_streamWorker.joinable())
+                m_streamWorker = std::thread([this] { RunStreamedAggregation(); });
+        }
+
+        // Submits the value with the given index for aggregation. The value is aggregated in place.
+        void SubmitForAggregation(size_t index, const NDArrayViewPtr& value)
+        {
+            if (!m_streamingActive)
+                LogicError("Streamed aggregation has not been started.");
+
+            {
+                std::lock_guard<std::mutex> lock(m_streamMutex);
+                if (index >= m_streamValues.size() || m_streamValues[index])
+                    LogicError("Value %d has already been submitted for aggregation or is out of range.", (int)index);
+
+                // The value is produced on the main compute stream, the quantization on the background thread
+                // has to wait for it.
+                m_streamMainStreamEvents[index].reset(MatrixComputeStreamEvent::Create(AsCNTKImplDeviceId(value->Device())));
+                m_streamValues[index] = value;
+            }
+
+            m_streamWorkAvailable.notify_one();
+        }
+
+        bool IsSubmittedForAggregation(size_t index)
+        {
+            std::lock_guard<std::mutex> lock(m_streamMutex);
+            return index < m_streamValues.size() && m_streamValues[index] != nullptr;
+        }
+
+        // Waits for all submitted values. All values must have been submitted. Once a value failed to aggregate,
+        // the remaining ones are skipped and the first error is rethrown here.
+        void EndStreamedAggregation()
+        {
+            if (!m_streamingActive)
+                LogicError("Streamed aggregation has not been started.");
+
+            std::unique_lock<std::mutex> lock(m_streamMutex);
+            for (const auto& value : m_streamValues)
+            {
+                if (!value)
+                    LogicError("Not all values have been submitted before ending the streamed aggregation.");
+            }
+
+            // Also after an error, the streaming thread must be done with all values before their residues go away.
+            m_streamValueAggregated.wait(lock, [this] { return std::all_of(m_streamAggregated.begin(), m_streamAggregated.end(), [](bool done) { return done; }); });
+
+            m_streamingActive = false;
+            m_streamValues.clear();
+            m_streamResidues = nullptr;
+            m_streamStripeResidues = nullptr;
+
+            if (m_streamError)
+            {
+                std::exception_ptr error = m_streamError;
+                m_streamError = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        ~QuantizedMPICommunicatorImpl()
+        {
+            if (m_streamWorker.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_streamMutex);
+                    m_streamStop = true;
+                }
+
+                m_streamWorkAvailable.notify_all();
+                m_streamWorker.join();
+            }
+        }
+
         // Redefining inherited members.
         // TODO: Use using and virtual inheritance after switching to VS2015.
         const std::unordered_set<DistributedWorkerDescriptor>& Workers() const override { return Base::Workers(); }
@@ -118,6 +291,53 @@ namespace CNTK
             Base::AggregateInPlace(values, sendToWorkers);
         }
 
+        // Nonblocking counterpart of AggregateInPlace for a single dense value of doubles on the CPU, e.g. a header
+        // of training statistics. The sum over all workers is available once EndAggregateInPlace returns, which allows
+        // overlapping the (latency bound) reduction with other communication. It is a collective operation, so all
+        // workers have to start their nonblocking aggregations in the same order.
+        void BeginAggregateInPlace(const NDArrayViewPtr& value, MPI_Request& request)
+        {
+            if (value->GetDataType() != DataType::Double || value->Device() != DeviceDescriptor::CPUDevice())
+                InvalidArgument("Nonblocking aggregation is only supported for double values on the CPU.");
+
+            request = MPI_REQUEST_NULL;
+            if (Workers().size() == 1) // No need to aggregate anything.
+                return;
+
+            double* data = value->WritableDataBuffer<double>();
+            int count = (int)value->Shape().TotalSize();
+            MpiCall([&] { m_mpi->Iallreduce(MPI_IN_PLACE, data, count, MPI_DOUBLE, MPI_SUM, &request) || MpiFail("MPI_Iallreduce"); });
+        }
+
+        void EndAggregateInPlace(MPI_Request& request)
+        {
+            if (request == MPI_REQUEST_NULL)
+                return;
+
+            MpiWaitall(1, &request);
+        }
+
+        // Per-peer arrival skew of the stripe exchanges, used to spot stragglers.
+        // Stragglers can additionally be reported on stderr, see PeerArrivalStatistics::SetLogInterval.
+        PeerArrivalStatistics& ArrivalStatistics()
+        {
+            return m_arrivalStatistics;
+        }
+
+        // Starts recording every 'samplingPeriod'-th aggregation for a timeline trace of all workers.
+        // Collective; has to be called while no aggregation is in flight.
+        void StartAggregationTrace(size_t samplingPeriod)
+        {
+            MpiCall([&] { AggregationTracer::Start(*m_mpi, samplingPeriod); });
+        }
+
+        // Collects the recorded phases of all workers and writes them as a Chrome trace on the main worker.
+        // Collective; has to be called while no aggregation is in flight.
+        void WriteAggregationTrace(const std::wstring& path)
+        {
+            MpiCall([&] { AggregationTracer::WriteMergedTrace(*m_mpi, path); });
+        }
+
         void Aggregate(
             const std::vector<NDArrayViewPtr>& values,
             std::vector<NDArrayViewPtr>& outputValues,
@@ -154,6 +374,23 @@ namespace CNTK
             size_t m_numCols;
         };
 
+        // Per-value buffers of a quantized aggregation. They are kept between aggregations
+        // and only reallocated if the shape or type of a value changes.
+        struct AggregationBuffers
+        {
+            // Buffer for quantized gradients.
+            vector<QuantizedMatrixBasePtr> m_quantizedGradients;
+
+            // Buffer for quantized stripes.
+            vector<vector<QuantizedMatrixBasePtr>> m_recvGradientStripesQuantized;
+
+            // Quantizers to quantize initial gradients.
+            vector<shared_ptr<MatrixQuantizerBase>> m_preAggregatedGradientQuantizers;
+
+            // Quantizers to quantize aggregated stripes.
+            vector<shared_ptr<MatrixQuantizerBase>> m_aggregatedGradientStripeQuantizers;
+        };
+
         // Determine which stripe of the gradient is this node responsible for
         Stripe GetStripeForNode(size_t numCols, size_t nodeRank, size_t numNodes)
         {
@@ -177,6 +414,7 @@ namespace CNTK
         }
 
         void InitializeBuffers(
+            AggregationBuffers& buffers,
             const vector<NDArrayViewPtr>& inValues,
             vector<NDArrayViewPtr>& valueQuantizationResidues,
             vector<NDArrayViewPtr>& stripeQuantizationResidues,
@@ -184,16 +422,16 @@ namespace CNTK
             vector<NDArrayViewPtr>& newQuantizationResidues,
             vector<NDArrayViewPtr>& newStripeQuantizationResidues)
         {
-            m_preAggregatedGradientQuantizers.resize(std::max(inValues.size(), valueQuantizationResidues.size()));
-            if (inValues.size() != m_preAggregatedGradientQuantizers.size())
+            buffers.m_preAggregatedGradientQuantizers.resize(std::max(inValues.size(), valueQuantizationResidues.size()));
+            if (inValues.size() != buffers.m_preAggregatedGradientQuantizers.size())
                 LogicError("Number of aggregated values should be equal number of quantized residuals.");
 
-            m_quantizedGradients.resize(inValues.size());
-            m_aggregatedGradientStripeQuantizers.resize(std::max(inValues.size(), stripeQuantizationResidues.size()));
-            if (inValues.size() != m_aggregatedGradientStripeQuantizers.size())
+            buffers.m_quantizedGradients.resize(inValues.size());
+            buffers.m_aggregatedGradientStripeQuantizers.resize(std::max(inValues.size(), stripeQuantizationResidues.size()));
+            if (inValues.size() != buffers.m_aggregatedGradientStripeQuantizers.size())
                 LogicError("Number of aggregated values should be equal number of striped quantized residuals.");
 
-            m_recvGradientStripesQuantized.resize(inValues.size());
+            buffers.m_recvGradientStripesQuantized.resize(inValues.size());
 
             if (valueQuantizationResidues.empty())
                 valueQuantizationResidues.resize(inValues.size());
@@ -217,9 +455,9 @@ namespace CNTK
 
                 // Currently we always use async aggregation. Is this correct?
                 if (view->GetDataType() == DataType::Float)
-                    InitializeBuffer<float>(inValues, valueQuantizationResidues, stripeQuantizationResidues, aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, i);
+                    InitializeBuffer<float>(buffers, inValues, valueQuantizationResidues, stripeQuantizationResidues, aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, i);
                 else if (view->GetDataType() == DataType::Double)
-                    InitializeBuffer<double>(inValues, valueQuantizationResidues, stripeQuantizationResidues, aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, i);
+                    InitializeBuffer<double>(buffers, inValues, valueQuantizationResidues, stripeQuantizationResidues, aggregatedOutputs, newQuantizationResidues, newStripeQuantizationResidues, i);
                 else
                     LogicError("Unsupported type");
             }
@@ -227,6 +465,7 @@ namespace CNTK
 
         template<class ElemType>
         void InitializeBuffer(
+            AggregationBuffers& buffers,
             const vector<NDArrayViewPtr>& inValues,
             vector<NDArrayViewPtr>& valueQuantizationResidues,
             vector<NDArrayViewPtr>& stripeQuantizationResidues,
@@ -262,11 +501,16 @@ namespace CNTK
 
             auto inResidual = valueQuantizationResidues[index];
 
+            // Keep the buffers of the previous aggregation if the value has the same shape and type.
+            auto quantizedGradient = dynamic_cast<QuantizedMatrix<ElemType>*>(buffers.m_quantizedGradients[index].get());
+            if (quantizedGradient && quantizedGradient->GetNumRows() == nRow && quantizedGradient->GetNumCols() == nCol)
+                return;
+
             // Initialize buffer.
-            m_quantizedGradients[index] = std::make_shared<QuantizedMatrix<ElemType>>(v->GetNumRows(), v->GetNumCols(), m_numQuantizationBits, CPUDEVICE, m_allocator.get());
+            buffers.m_quantizedGradients[index] = std::make_shared<QuantizedMatrix<ElemType>>(v->GetNumRows(), v->GetNumCols(), m_numQuantizationBits, CPUDEVICE, m_allocator.get());
 
             // Initialize gradient quantizer.
-            m_preAggregatedGradientQuantizers[index] = std::make_shared<MatrixQuantizer<ElemType>>(GetMatrix<ElemType>(inResidual)->GetDeviceId(), true);
+            buffers.m_preAggregatedGradientQuantizers[index] = std::make_shared<MatrixQuantizer<ElemType>>(GetMatrix<ElemType>(inResidual)->GetDeviceId(), true);
 
             // Determine which stripe of the gradient is this node responsible for
             MatrixQuantizer<ElemType>* aggregatedGradientStripeQuantizers = nullptr;
@@ -274,16 +518,17 @@ namespace CNTK
             {
                 // Initialize quantizer
                 aggregatedGradientStripeQuantizers = new MatrixQuantizer<ElemType>(GetMatrix<ElemType>(inResidual)->GetDeviceId(), true);
-                m_recvGradientStripesQuantized[index].resize(numWorkers - 1);
+                buffers.m_recvGradientStripesQuantized[index].resize(numWorkers - 1);
                 for (size_t j = 0; j < numWorkers - 1; ++j)
-                    m_recvGradientStripesQuantized[index][j]= std::unique_ptr<QuantizedMatrix<ElemType>>(new QuantizedMatrix<ElemType>(v->GetNumRows(), stripe.m_numCols, m_numQuantizationBits, CPUDEVICE, m_allocator.get()));
+                    buffers.m_recvGradientStripesQuantized[index][j]= std::unique_ptr<QuantizedMatrix<ElemType>>(new QuantizedMatrix<ElemType>(v->GetNumRows(), stripe.m_numCols, m_numQuantizationBits, CPUDEVICE, m_allocator.get()));
             }
 
-            m_aggregatedGradientStripeQuantizers[index] = std::unique_ptr<MatrixQuantizer<ElemType>>(aggregatedGradientStripeQuantizers);
+            buffers.m_aggregatedGradientStripeQuantizers[index] = std::unique_ptr<MatrixQuantizer<ElemType>>(aggregatedGradientStripeQuantizers);
         }
 
         template<class ElemType>
         void QuantizedAggregate(
+            AggregationBuffers& buffers,
             const vector<NDArrayViewPtr>& inValues,
             const vector<NDArrayViewPtr>& formalValueQuantizationResidues,
             const vector<NDArrayViewPtr>& formalStripeQuantizationResidues,
@@ -301,6 +546,7 @@ namespace CNTK
             auto stripeQuantizationResidues = formalStripeQuantizationResidues;
 
             InitializeBuffers(
+                buffers,
                 inValues,
                 valueQuantizationResidues,
                 stripeQuantizationResidues,
@@ -353,45 +599,130 @@ namespace CNTK
                 if (stripe.m_numCols > 0)
                 {
                     currAggGradStripe = new Matrix<ElemType>(inputValues[i]->ColumnSlice(stripe.m_startCol, stripe.m_numCols));
-                    currAggGradStripeQuantized = new QuantizedMatrix<ElemType>(GetQuantizedMatrix<ElemType>(*m_quantizedGradients[i]).ColumnSlice(stripe.m_startCol, stripe.m_numCols));
+                    currAggGradStripeQuantized = new QuantizedMatrix<ElemType>(GetQuantizedMatrix<ElemType>(*buffers.m_quantizedGradients[i]).ColumnSlice(stripe.m_startCol, stripe.m_numCols));
                 }
 
                 aggGradStripes.push_back(std::unique_ptr<Matrix<ElemType>>(currAggGradStripe));
                 aggGradStripesQuantized.push_back(std::unique_ptr<QuantizedMatrix<ElemType>>(currAggGradStripeQuantized));
             }
 
+            // Values are processed by priority, so the ones needed first by the next forward pass are
+            // quantized (the quantizers share a compute stream), exchanged and unquantized first.
+            const vector<size_t> order = AggregationOrder(inValues.size());
+
             // Initiate quantization of the gradient matrices
-            for (size_t i = 0; i < inValues.size(); ++i)
-                GetQuantizer<ElemType>(m_preAggregatedGradientQuantizers[i]).QuantizeAsync(*(inputValues[i]), *(inputResiduals[i]), GetQuantizedMatrix<ElemType>(*(m_quantizedGradients[i])), *(outputResiduals[i]), m_zeroThresholdFor1Bit);
+            for (size_t i : order)
+                GetQuantizer<ElemType>(buffers.m_preAggregatedGradientQuantizers[i]).QuantizeAsync(*(inputValues[i]), *(inputResiduals[i]), GetQuantizedMatrix<ElemType>(*(buffers.m_quantizedGradients[i])), *(outputResiduals[i]), m_zeroThresholdFor1Bit);
 
-            // Initiate receive of the stripe to be aggregated by the current node, from all other nodes
+            // Message ids of the different transfers; MessageTag maps them into the range of tags supported by MPI.
+            const size_t stripeMessageId = 0;
+            const size_t aggregatedStripeMessageId = inValues.size() + 1;
+
+            // Initiate receive of the stripe to be aggregated by the current node, from all other nodes.
+            // Stripes larger than MaxMessageChunkBytes arrive in several chunks, each with its own request.
             vector<MPI_Request> recvGradStripesQuantizedRequests;
             vector<int> recvRequestIdxToGradientMatrixIdxMap;
-            for (int i = 0; i < inputValues.size(); ++i)
+            vector<size_t> recvRequestIdxToStripeIdxMap;
+            vector<size_t> recvGradMatrixRequestRangeBegin;
+            for (size_t i : order)
             {
                 Stripe stripe = GetStripeForNode(inputValues[i]->GetNumCols(), rank, numWorkers);
                 if (stripe.m_numCols > 0)
                 {
-                    recvRequestIdxToGradientMatrixIdxMap.push_back(i);
+                    recvRequestIdxToGradientMatrixIdxMap.push_back((int)i);
+                    recvGradMatrixRequestRangeBegin.push_back(recvGradStripesQuantizedRequests.size());
                     for (int j = 0; j < numWorkers - 1; ++j)
                     {
                         int source = (j >= rank) ? (j + 1) : j;
+                        auto& recvStripe = GetQuantizedMatrix<ElemType>(*buffers.m_recvGradientStripesQuantized[i][j]);
 
-                        recvGradStripesQuantizedRequests.push_back(MPI_Request());
-                        int recvRequestIdx = (int)recvGradStripesQuantizedRequests.size() - 1;
-
-                        m_mpi->Irecv(GetQuantizedMatrix<ElemType>(*m_recvGradientStripesQuantized[i][j]).Buffer(), (int)GetQuantizedMatrix<ElemType>(*m_recvGradientStripesQuantized[i][j]).GetSize(), MPI_CHAR, source, i, &(recvGradStripesQuantizedRequests[recvRequestIdx])) || MpiFail("MPI_Irecv");
+                        MpiCall([&] { IrecvChunked(*m_mpi, recvStripe.Buffer(), recvStripe.GetSize(), source, MessageTag(stripeMessageId + i), recvGradStripesQuantizedRequests); });
+                        recvRequestIdxToStripeIdxMap.resize(recvGradStripesQuantizedRequests.size(), (recvRequestIdxToGradientMatrixIdxMap.size() - 1) * (numWorkers - 1) + j);
                     }
                 }
             }
 
+            recvGradMatrixRequestRangeBegin.push_back(recvGradStripesQuantizedRequests.size());
+
+            // Number of chunks still outstanding per received stripe.
+            vector<size_t> recvStripeChunksPending(recvRequestIdxToGradientMatrixIdxMap.size() * (numWorkers - 1), 0);
+            for (size_t stripeIdx : recvRequestIdxToStripeIdxMap)
+                recvStripeChunksPending[stripeIdx]++;
+
+            // Unquantizes and accumulates a received stripe into the aggregate of the stripe owned by this node.
+            // Once the last expected stripe for the matrix arrived, the quantization of the aggregate is issued.
+            AggregationProfiler& profiler = AggregationProfiler::Get();
+            long long exchangeBeginNs = profiler.Now();
+            m_arrivalStatistics.BeginRound(numWorkers);
+            std::vector<int> perGradMatrixReceiveCount(recvRequestIdxToGradientMatrixIdxMap.size(), 0);
+            auto accumulateReceivedStripe = [&](int gradMatrixIdxPosition, int recvBufferSubIndex, PeerArrivalStatistics::Clock::time_point completionTime)
+            {
+                // Map back to the actual gradient matrix index
+                int gradMatrixIdx = recvRequestIdxToGradientMatrixIdxMap[gradMatrixIdxPosition];
+
+                int source = (recvBufferSubIndex >= rank) ? (recvBufferSubIndex + 1) : recvBufferSubIndex;
+                m_arrivalStatistics.RecordArrival(source, completionTime);
+                profiler.Record(AggregationPhase::StripeArrival, source, exchangeBeginNs, profiler.Timestamp(completionTime));
+
+                // Wait for the previous Unquantize to finish before issuing a new one
+                if (m_useQuantizationForSelfStripe || (perGradMatrixReceiveCount[gradMatrixIdxPosition] > 0))
+                    GetQuantizer<ElemType>(buffers.m_aggregatedGradientStripeQuantizers[gradMatrixIdx]).WaitUnquantizeAsyncDone();
+
+                {
+                    // When profiling, wait for the unquantization, so that the phase covers it rather than just issuing it.
+                    ScopedAggregationPhase unquantizePhase(AggregationPhase::UnquantizeAccumulate, source);
+                    GetQuantizer<ElemType>(buffers.m_aggregatedGradientStripeQuantizers[gradMatrixIdx]).UnquantizeAsync(
+                        GetQuantizedMatrix<ElemType>(*buffers.m_recvGradientStripesQuantized[gradMatrixIdx][recvBufferSubIndex]),
+                        *(aggGradStripes[gradMatrixIdx]),
+                        true);
+                    if (profiler.IsEnabled())
+                        GetQuantizer<ElemType>(buffers.m_aggregatedGradientStripeQuantizers[gradMatrixIdx]).WaitUnquantizeAsyncDone();
+                }
+
+                perGradMatrixReceiveCount[gradMatrixIdxPosition]++;
+
+                // Also issue the quantization if this stripe was the last one expected for this matrix
+                // Note: We issue the quantization without waiting for the unquantization since the same stream
+                // is used for both and they are implicitly sequenced
+                // We reuse the buffer that we used for quantizing and sending out the pre-aggregation gradient
+                if (perGradMatrixReceiveCount[gradMatrixIdxPosition] == (numWorkers - 1))
+                {
+                    Stripe stripe = GetStripeForNode(inputValues[gradMatrixIdx]->GetNumCols(), rank, numWorkers);
+                    UNUSED(stripe);
+                    assert(stripe.m_numCols > 0);
+                    GetQuantizer<ElemType>(buffers.m_aggregatedGradientStripeQuantizers[gradMatrixIdx]).QuantizeAsync(
+                        *(aggGradStripes[gradMatrixIdx]),
+                        *(inputStripeResiduals[gradMatrixIdx]),
+                        *(aggGradStripesQuantized[gradMatrixIdx]),
+                        *(outputStripeResiduals[gradMatrixIdx]),
+                        m_zeroThresholdFor1Bit);
+                }
+            };
+
+            // Accounts for a received chunk and accumulates the stripe once all of its chunks are in.
+            // 'completionTime' is the time MPI reported the receive of the chunk complete.
+            auto onStripeChunkReceived = [&](size_t recvRequestIdx, PeerArrivalStatistics::Clock::time_point completionTime)
+            {
+                size_t stripeIdx = recvRequestIdxToStripeIdxMap[recvRequestIdx];
+                if (--recvStripeChunksPending[stripeIdx] == 0)
+                    accumulateReceivedStripe((int)(stripeIdx / (numWorkers - 1)), (int)(stripeIdx % (numWorkers - 1)), completionTime);
+            };
+
+            // Callbacks handed to the progress thread refer to the locals above. Should anything throw
+            // before they all ran, the requests still tracked are cancelled before the locals go away.
+            std::vector<size_t> perGradMatrixAggStripesPending(inValues.size());
+            ScopedTrackedRequests trackedRequests(m_progressEngine.get());
+
             // Asynchronously send stripes of the quantized gradient matrices to the respective nodes that own aggregation of that stripe
             std::vector<std::vector<MPI_Request>> sendGradStripesQuantizedRequests(inValues.size());
-            for (int i = 0; i < inValues.size(); ++i)
+            size_t recvGradMatrixIdxPosition = 0;
+            for (size_t i : order)
             {
-                GetQuantizer<ElemType>(m_preAggregatedGradientQuantizers[i]).WaitQuantizeAsyncDone();
+                {
+                    ScopedAggregationPhase quantizePhase(AggregationPhase::Quantize);
+                    GetQuantizer<ElemType>(buffers.m_preAggregatedGradientQuantizers[i]).WaitQuantizeAsyncDone();
+                }
 
-                size_t sendRequestIdx = 0;
                 for (int j = 0; j < numWorkers; ++j)
                 {
                     Stripe stripe = GetStripeForNode(inputValues[i]->GetNumCols(), j, numWorkers);
@@ -400,11 +731,10 @@ namespace CNTK
                         // Do not send stripe for self
                         if (j != rank)
                         {
-                            sendGradStripesQuantizedRequests[i].push_back(MPI_Request());
-                            QuantizedMatrix<ElemType> quantizedStripe = GetQuantizedMatrix<ElemType>(*m_quantizedGradients[i]).ColumnSlice(stripe.m_startCol, stripe.m_numCols);
+                            QuantizedMatrix<ElemType> quantizedStripe = GetQuantizedMatrix<ElemType>(*buffers.m_quantizedGradients[i]).ColumnSlice(stripe.m_startCol, stripe.m_numCols);
 
-                            m_mpi->Isend(quantizedStripe.Buffer(), (int)quantizedStripe.GetSize(), MPI_CHAR, j, i, &(sendGradStripesQuantizedRequests[i][sendRequestIdx])) || MpiFail("MPI_Isend");
-                            sendRequestIdx++;
+                            ScopedAggregationPhase sendPhase(AggregationPhase::SendPost, j);
+                            MpiCall([&] { IsendChunked(*m_mpi, quantizedStripe.Buffer(), quantizedStripe.GetSize(), j, MessageTag(stripeMessageId + i), sendGradStripesQuantizedRequests[i]); });
                         }
                         else
                         {
@@ -412,71 +742,68 @@ namespace CNTK
                             // gradients themselves, if so desired
                             if (m_useQuantizationForSelfStripe)
                             {
-                                QuantizedMatrix<ElemType> preAggGradSelfStripeQuantized = GetQuantizedMatrix<ElemType>(*m_quantizedGradients[i]).ColumnSlice(stripe.m_startCol, stripe.m_numCols);
-                                GetQuantizer<ElemType>(m_aggregatedGradientStripeQuantizers[i]).UnquantizeAsync(preAggGradSelfStripeQuantized, *(aggGradStripes[i]), false);
+                                QuantizedMatrix<ElemType> preAggGradSelfStripeQuantized = GetQuantizedMatrix<ElemType>(*buffers.m_quantizedGradients[i]).ColumnSlice(stripe.m_startCol, stripe.m_numCols);
+                                GetQuantizer<ElemType>(buffers.m_aggregatedGradientStripeQuantizers[i]).UnquantizeAsync(preAggGradSelfStripeQuantized, *(aggGradStripes[i]), false);
                             }
                         }
                     }
                 }
+
+                // With a progress thread, hand the receives of this matrix over as soon as the matrix is ready to accumulate into:
+                // its quantization is done (the self stripe aliases the input) and the self stripe has been initialized.
+                if (m_progressEngine && (recvGradMatrixIdxPosition < recvRequestIdxToGradientMatrixIdxMap.size()) && (recvRequestIdxToGradientMatrixIdxMap[recvGradMatrixIdxPosition] == (int)i))
+                {
+                    int deviceId = inputValues[i]->GetDeviceId();
+                    for (size_t r = recvGradMatrixRequestRangeBegin[recvGradMatrixIdxPosition]; r < recvGradMatrixRequestRangeBegin[recvGradMatrixIdxPosition + 1]; ++r)
+                    {
+                        m_progressEngine->Track(recvGradStripesQuantizedRequests[r], [this, &onStripeChunkReceived, deviceId, r]
+                        {
+                            // Callbacks run on the progress thread, make sure it uses the right device.
+                            Matrix<ElemType>::SetDevice(deviceId);
+                            onStripeChunkReceived(r, m_progressEngine->CompletionTime());
+                        });
+                    }
+
+                    recvGradMatrixIdxPosition++;
+                }
             }
 
             // Wait for the stripes to arrive from each node and unquantize and aggregate
             size_t numReceivesExpected = recvGradStripesQuantizedRequests.size();
             size_t numActualReceives = 0;
-            std::vector<int> perGradMatrixReceiveCount(recvRequestIdxToGradientMatrixIdxMap.size(), 0);
+            if (m_progressEngine)
+            {
+                m_progressEngine->WaitAll();
+                numActualReceives = numReceivesExpected;
+            }
+
+            // All receives that completed by now are taken at once, so that they arrive at the time MPI reports
+            // them complete, rather than after the stripes processed before them have been unquantized.
+            vector<int> completedRequests(recvGradStripesQuantizedRequests.size());
             while (numActualReceives < numReceivesExpected)
             {
-                int idx = MPI_UNDEFINED;
-                m_mpi->Waitany((int)recvGradStripesQuantizedRequests.size(), recvGradStripesQuantizedRequests.data(), &idx, MPI_STATUS_IGNORE) || MpiFail("MPI_Waitany");
-                if (idx == MPI_UNDEFINED)
+                int numCompleted = MPI_UNDEFINED;
+                MPI_Waitsome((int)recvGradStripesQuantizedRequests.size(), recvGradStripesQuantizedRequests.data(), &numCompleted, completedRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitsome");
+                if (numCompleted == MPI_UNDEFINED)
                 {
                     break;
                 }
 
-                numActualReceives++;
-
-                int gradMatrixIdxPosition = idx / (numWorkers - 1);
-                int recvBufferSubIndex = idx % (numWorkers - 1);
-
-                // Map idx back to the actual gradient matrix index
-                int gradMatrixIdx = recvRequestIdxToGradientMatrixIdxMap[gradMatrixIdxPosition];
-
-                // Wait for the previous Unquantize to finish before issuing a new one
-                if (m_useQuantizationForSelfStripe || (perGradMatrixReceiveCount[gradMatrixIdxPosition] > 0))
-                    GetQuantizer<ElemType>(m_aggregatedGradientStripeQuantizers[gradMatrixIdx]).WaitUnquantizeAsyncDone();
-
-                GetQuantizer<ElemType>(m_aggregatedGradientStripeQuantizers[gradMatrixIdx]).UnquantizeAsync(
-                    GetQuantizedMatrix<ElemType>(*m_recvGradientStripesQuantized[gradMatrixIdx][recvBufferSubIndex]),
-                    *(aggGradStripes[gradMatrixIdx]),
-                    true);
-
-                perGradMatrixReceiveCount[gradMatrixIdxPosition]++;
-
-                // Also issue the quantization if this stripe was the last one expected for this matrix
-                // Note: We issue the quantization without waiting for the unquantization since the same stream
-                // is used for both and they are implicitly sequenced
-                // We reuse the buffer that we used for quantizing and sending out the pre-aggregation gradient
-                if (perGradMatrixReceiveCount[gradMatrixIdxPosition] == (numWorkers - 1))
+                auto completionTime = PeerArrivalStatistics::Clock::now();
+                for (int k = 0; k < numCompleted; ++k)
                 {
-                    Stripe stripe = GetStripeForNode(inputValues[gradMatrixIdx]->GetNumCols(), rank, numWorkers);
-                    UNUSED(stripe);
-                    assert(stripe.m_numCols > 0);
-                    GetQuantizer<ElemType>(m_aggregatedGradientStripeQuantizers[gradMatrixIdx]).QuantizeAsync(
-                        *(aggGradStripes[gradMatrixIdx]),
-                        *(inputStripeResiduals[gradMatrixIdx]),
-                        *(aggGradStripesQuantized[gradMatrixIdx]),
-                        *(outputStripeResiduals[gradMatrixIdx]),
-                        m_zeroThresholdFor1Bit);
+                    numActualReceives++;
+                    onStripeChunkReceived((size_t)completedRequests[k], completionTime);
                 }
             }
 
             assert(numActualReceives == numReceivesExpected);
+            m_arrivalStatistics.EndRound();
 
             vector<vector<MPI_Request>> recvAggGradStripesQuantizedRequests(inValues.size());
             // Initiate receive of stripes of quantized aggregated gradients from different nodes
-            for (int i = 0; i < inValues.size(); ++i)
+            for (size_t i : order)
             {
-                int recvRequestIdx = 0;
                 for (int j = 0; j < numWorkers; ++j)
                 {
                     // Do not recv stripe for self
@@ -485,10 +812,8 @@ namespace CNTK
                         Stripe stripe = GetStripeForNode(inputValues[i]->GetNumCols(), j, numWorkers);
                         if (stripe.m_numCols > 0)
                         {
-                            recvAggGradStripesQuantizedRequests[i].push_back(MPI_Request());
-                            QuantizedMatrix<ElemType> quantizedStripe = GetQuantizedMatrix<ElemType>(*m_quantizedGradients[i]).ColumnSlice(stripe.m_startCol, stripe.m_numCols);
-                            m_mpi->Irecv(quantizedStripe.Buffer(), (int)quantizedStripe.GetSize(), MPI_CHAR, j, (int)inValues.size() + 1 + i, &(recvAggGradStripesQuantizedRequests[i][recvRequestIdx])) || MpiFail("MPI_Irecv");
-                            recvRequestIdx++;
+                            QuantizedMatrix<ElemType> quantizedStripe = GetQuantizedMatrix<ElemType>(*buffers.m_quantizedGradients[i]).ColumnSlice(stripe.m_startCol, stripe.m_numCols);
+                            MpiCall([&] { IrecvChunked(*m_mpi, quantizedStripe.Buffer(), quantizedStripe.GetSize(), j, MessageTag(aggregatedStripeMessageId + i), recvAggGradStripesQuantizedRequests[i]); });
                         }
                     }
                 }
@@ -496,48 +821,199 @@ namespace CNTK
 
             // Initiate broadcast of quantized aggregated gradient stripes to all other nodes
             vector<vector<MPI_Request>> sendAggGradStripeQuantizedRequests(inValues.size());
-            for (int i = 0; i < inValues.size(); ++i)
+            for (size_t i : order)
             {
                 Stripe stripe = GetStripeForNode(inputValues[i]->GetNumCols(), rank, numWorkers);
                 if (stripe.m_numCols > 0)
                 {
-                    sendAggGradStripeQuantizedRequests[i] = std::vector<MPI_Request>(numWorkers - 1);
-                    GetQuantizer<ElemType>(m_aggregatedGradientStripeQuantizers[i]).WaitQuantizeAsyncDone();
+                    {
+                        ScopedAggregationPhase requantizePhase(AggregationPhase::Requantize);
+                        GetQuantizer<ElemType>(buffers.m_aggregatedGradientStripeQuantizers[i]).WaitQuantizeAsyncDone();
+                    }
+
                     for (int j = 0; j < numWorkers - 1; ++j)
                     {
                         int dest = (j >= rank) ? (j + 1) : j;
 
                         // TODO: Should we use MPI_Bcast instead for better performance
-                        m_mpi->Isend(aggGradStripesQuantized[i]->Buffer(), (int)aggGradStripesQuantized[i]->GetSize(), MPI_CHAR, dest, (int)inValues.size() + 1 + i, &(sendAggGradStripeQuantizedRequests[i][j])) || MpiFail("MPI_Irecv");
+                        MpiCall([&] { IsendChunked(*m_mpi, aggGradStripesQuantized[i]->Buffer(), aggGradStripesQuantized[i]->GetSize(), dest, MessageTag(aggregatedStripeMessageId + i), sendAggGradStripeQuantizedRequests[i]); });
+                    }
+                }
+
+                // With a progress thread, the final unquantization of a matrix is issued as soon as all its aggregated stripes arrived.
+                // It overwrites the stripe the requantization above reads from, so it is only handed over once that is done.
+                if (m_progressEngine)
+                {
+                    perGradMatrixAggStripesPending[i] = recvAggGradStripesQuantizedRequests[i].size();
+                    int deviceId = inputValues[i]->GetDeviceId();
+                    for (auto& request : recvAggGradStripesQuantizedRequests[i])
+                    {
+                        m_progressEngine->Track(request, [this, &buffers, &perGradMatrixAggStripesPending, &outputValues, deviceId, i]
+                        {
+                            if (--perGradMatrixAggStripesPending[i] > 0)
+                                return;
+
+                            Matrix<ElemType>::SetDevice(deviceId);
+                            GetQuantizer<ElemType>(buffers.m_preAggregatedGradientQuantizers[i]).UnquantizeAsync(GetQuantizedMatrix<ElemType>(*buffers.m_quantizedGradients[i]), *(outputValues[i]), false);
+                        });
                     }
                 }
             }
 
             // Wait to receive all aggregated stripes and unquantize
-            for (size_t i = 0; i < inValues.size(); ++i)
+            if (m_progressEngine)
             {
-                m_mpi->Waitall((int)recvAggGradStripesQuantizedRequests[i].size(), recvAggGradStripesQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
-                GetQuantizer<ElemType>(m_preAggregatedGradientQuantizers[i]).UnquantizeAsync(GetQuantizedMatrix<ElemType>(*m_quantizedGradients[i]), *(outputValues[i]), false);
+                {
+                    ScopedAggregationPhase allgatherPhase(AggregationPhase::Allgather);
+                    m_progressEngine->WaitAll();
+                }
+
+                // Matrices without remote stripes have nothing to wait for
+                for (size_t i : order)
+                {
+                    if (recvAggGradStripesQuantizedRequests[i].empty())
+                        GetQuantizer<ElemType>(buffers.m_preAggregatedGradientQuantizers[i]).UnquantizeAsync(GetQuantizedMatrix<ElemType>(*buffers.m_quantizedGradients[i]), *(outputValues[i]), false);
+                }
+            }
+            else
+            {
+                for (size_t i : order)
+                {
+                    {
+                        ScopedAggregationPhase allgatherPhase(AggregationPhase::Allgather);
+                        m_mpi->Waitall((int)recvAggGradStripesQuantizedRequests[i].size(), recvAggGradStripesQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+                    }
+
+                    GetQuantizer<ElemType>(buffers.m_preAggregatedGradientQuantizers[i]).UnquantizeAsync(GetQuantizedMatrix<ElemType>(*buffers.m_quantizedGradients[i]), *(outputValues[i]), false);
+                }
             }
 
             // Wait for all the unquantizations to finish
-            for (size_t i = 0; i < inValues.size(); ++i)
-                GetQuantizer<ElemType>(m_preAggregatedGradientQuantizers[i]).WaitUnquantizeAsyncDone();
+            {
+                ScopedAggregationPhase finalUnquantizePhase(AggregationPhase::FinalUnquantize);
+                for (size_t i : order)
+                    GetQuantizer<ElemType>(buffers.m_preAggregatedGradientQuantizers[i]).WaitUnquantizeAsyncDone();
+            }
 
             // Wait for completion of the async send requests
             for (int i = 0; i < sendGradStripesQuantizedRequests.size(); ++i)
             {
                 if (sendGradStripesQuantizedRequests[i].size() > 0)
-                    m_mpi->Waitall((int)sendGradStripesQuantizedRequests[i].size(), sendGradStripesQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+                    MpiWaitall((int)sendGradStripesQuantizedRequests[i].size(), sendGradStripesQuantizedRequests[i].data());
             }
 
             for (int i = 0; i < sendAggGradStripeQuantizedRequests.size(); ++i)
             {
                 if (sendAggGradStripeQuantizedRequests[i].size() > 0)
-                    m_mpi->Waitall((int)sendAggGradStripeQuantizedRequests[i].size(), sendAggGradStripeQuantizedRequests[i].data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+                    MpiWaitall((int)sendAggGradStripeQuantizedRequests[i].size(), sendAggGradStripeQuantizedRequests[i].data());
+            }
+        }
+
+        // Returns the order in which the values of a batched aggregation are processed, see SetAggregationPriorities.
+        vector<size_t> AggregationOrder(size_t numValues) const
+        {
+            vector<size_t> order(numValues);
+            std::iota(order.begin(), order.end(), 0);
+            if (numValues <= 1)
+                return order;
+
+            if (m_aggregationPriorities.size() == numValues)
+                std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return m_aggregationPriorities[a] < m_aggregationPriorities[b]; });
+
+            return order;
+        }
+
+        // Body of the streamed aggregation thread.
+        void RunStreamedAggregation()
+        {
+            for (;;)
+            {
+                size_t index;
+                NDArrayViewPtr value;
+                std::unique_ptr<MatrixComputeStreamEvent> mainStreamSyncEvent;
+                {
+                    std::unique_lock<std::mutex> lock(m_streamMutex);
+                    m_streamWorkAvailable.wait(lock, [this] { return m_streamStop || (m_streamNextIndex < m_streamValues.size() && m_streamValues[m_streamNextIndex]); });
+                    if (m_streamStop)
+                        return;
+
+                    index = m_streamNextIndex++;
+                    value = m_streamValues[index];
+                    mainStreamSyncEvent = std::move(m_streamMainStreamEvents[index]);
+
+                    // Once a value failed, the streamed aggregation is given up and the remaining values are skipped.
+                    if (m_streamError)
+                        value = nullptr;
+                }
+
+                std::exception_ptr error;
+                try
+                {
+                    if (value && value->GetDataType() == DataType::Float)
+                        AggregateStreamedValue<float>(index, value, *mainStreamSyncEvent);
+                    else if (value && value->GetDataType() == DataType::Double)
+                        AggregateStreamedValue<double>(index, value, *mainStreamSyncEvent);
+                    else if (value)
+                        LogicError("Unexpected type value.");
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(m_streamMutex);
+                    if (error && !m_streamError)
+                        m_streamError = error;
+                    m_streamAggregated[index] = true;
+                }
+
+                m_streamValueAggregated.notify_all();
             }
         }
 
+        template<class ElemType>
+        void AggregateStreamedValue(size_t index, const NDArrayViewPtr& value, MatrixComputeStreamEvent& mainStreamSyncEvent)
+        {
+            // We are on the streaming thread. Make sure it uses the right device and that
+            // the value has been computed on the main compute stream.
+            Matrix<ElemType>::SetDevice(AsCNTKImplDeviceId(value->Device()));
+            mainStreamSyncEvent.SynchronizeQuantizationComputeStreamWithEvent<ElemType>();
+
+            if (Workers().size() == 1) // No need to aggregate anything.
+                return;
+
+            // Each value is a separate aggregation of a single value with buffers of its own, which are
+            // kept for the next streamed aggregation. Message tags cannot clash between values, since
+            // one aggregation finishes before the next one starts.
+            vector<NDArrayViewPtr> values{ value };
+            vector<NDArrayViewPtr> residues{ (*m_streamResidues)[index] };
+            vector<NDArrayViewPtr> stripeResidues{ (*m_streamStripeResidues)[index] };
+            QuantizedAggregate<ElemType>(m_streamBuffers[index], values, residues, stripeResidues, values, residues, stripeResidues, Workers());
+
+            (*m_streamResidues)[index] = residues.front();
+            (*m_streamStripeResidues)[index] = stripeResidues.front();
+        }
+
+        // Issues an MPI call, serialized with the progress thread if there is one.
+        template <class Func>
+        void MpiCall(const Func& mpiCall)
+        {
+            if (m_progressEngine)
+                m_progressEngine->Post(mpiCall);
+            else
+                mpiCall();
+        }
+
+        // Waits for nonblocking requests; with a progress thread without holding it up for the duration of the wait.
+        void MpiWaitall(int count, MPI_Request* requests)
+        {
+            if (m_progressEngine)
+                m_progressEngine->WaitForRequests(count, requests);
+            else
+                m_mpi->Waitall(count, requests, MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        }
+
         // option for handling the mean for 1-bit quantization
         // force 1-bit quant to threshold against 0 rather than the midpoint between lower and upper
         const bool m_zeroThresholdFor1Bit;
@@ -552,16 +1028,32 @@ namespace CNTK
 
         const std::unique_ptr<CUDAPageLockedMemAllocator> m_allocator;
 
-        // Buffer for quantized gradients.
-        vector<QuantizedMatrixBasePtr> m_quantizedGradients;
-
-        // Buffer for quantized stripes.
-        vector<vector<QuantizedMatrixBasePtr>> m_recvGradientStripesQuantized;
-
-        // Quantizers to quantize initial gradients.
-        vector<shared_ptr<MatrixQuantizerBase>> m_preAggregatedGradientQuantizers;
-
-        // Quantizers to quantize aggregated stripes.
-        vector<shared_ptr<MatrixQuantizerBase>> m_aggregatedGradientStripeQuantizers;
+        // Buffers of the batched aggregations.
+        AggregationBuffers m_buffers;
+
+        // Optional background thread that progresses the stripe exchanges and
+        // unquantizes received stripes as soon as they arrive.
+        std::unique_ptr<MPIProgressEngine> m_progressEngine;
+
+        PeerArrivalStatistics m_arrivalStatistics;
+
+        // State of the streamed aggregation, guarded by m_streamMutex.
+        std::thread m_streamWorker;
+        std::mutex m_streamMutex;
+        std::condition_variable m_streamWorkAvailable;
+        std::condition_variable m_streamValueAggregated;
+        bool m_streamStop = false;
+        bool m_streamingActive = false;
+        size_t m_streamNextIndex = 0;
+        vector<NDArrayViewPtr> m_streamValues;
+        vector<std::unique_ptr<MatrixComputeStreamEvent>> m_streamMainStreamEvents;
+        vector<bool> m_streamAggregated;
+        vector<NDArrayViewPtr>* m_streamResidues = nullptr;
+        vector<NDArrayViewPtr>* m_streamStripeResidues = nullptr;
+        vector<AggregationBuffers> m_streamBuffers;
+        std::exception_ptr m_streamError;
+
+        // Per-value priorities of batched aggregations, see SetAggregationPriorities.
+        vector<int> m_aggregationPriorities;
     };
 }
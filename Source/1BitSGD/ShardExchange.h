@@ -0,0 +1,153 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "MPIWrapper.h"
+#include "MPITransfer.h"
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// =======================================================================
+// ShardExchange -- ring reduce-scatter and allgather of data that is split into
+// one shard per rank, among all ranks of a job. Rank r owns shard r: the reduce-scatter
+// leaves it with the sum of its shard over all ranks, the allgather copies the owned
+// shards to all ranks. The data stays with the caller, which copies shards to and
+// from host buffers through callbacks, so it may live on any device and need not be
+// contiguous; at most three shards are staged on the host. Every rank sends and
+// receives (N-1)/N of the data per operation, so both together cost the traffic of a
+// single all-reduce. Every method has to be called by all ranks, in the same order,
+// and not concurrently with other MPI traffic of this object.
+// =======================================================================
+
+class ShardExchange
+{
+public:
+    explicit ShardExchange(MPIWrapper& mpi)
+        : m_mpi(mpi), m_rank((int)mpi.CurrentNodeRank()), m_numRanks((int)mpi.NumNodesInUse())
+    {}
+
+    // Disallow copy and move construction and assignment
+    DISABLE_COPY_AND_MOVE(ShardExchange);
+
+    // Copies the values of shard 'shard' on this rank to the host buffer, or from it.
+    template <class ElemType>
+    using ShardCopy = std::function<void(int shard, ElemType* host)>;
+
+    // Sums the data over all ranks into the shard owned by this rank. 'shardSizes' holds the number of elements of
+    // every shard. 'copyOut' reads the values of a shard, 'copyIn' replaces the owned shard by the sum; the other
+    // shards are left unchanged.
+    template <class ElemType>
+    void ReduceScatter(const std::vector<size_t>& shardSizes, const ShardCopy<ElemType>& copyOut, const ShardCopy<ElemType>& copyIn)
+    {
+        CheckShardSizes(shardSizes);
+        if (m_numRanks == 1)
+            return;
+
+        ElemType* buffers[3];
+        ReserveBuffers(shardSizes, buffers, 3);
+        ElemType* sending = buffers[0];
+        ElemType* received = buffers[1];
+        ElemType* accumulated = buffers[2];
+
+        // The partial sum of a shard travels around the ring and arrives complete at its owner after N - 1 steps.
+        // The own values of the shard received next are read while the transfer is in flight.
+        copyOut(Wrap(m_rank - 1), sending);
+        for (int step = 0; step < m_numRanks - 1; ++step)
+        {
+            int sendShard = Wrap(m_rank - 1 - step);
+            int recvShard = Wrap(m_rank - 2 - step);
+            IsendChunked(m_mpi, sending, shardSizes[sendShard] * sizeof(ElemType), Wrap(m_rank + 1), ShardMessageTag, m_requests);
+            IrecvChunked(m_mpi, received, shardSizes[recvShard] * sizeof(ElemType), Wrap(m_rank - 1), ShardMessageTag, m_requests);
+            copyOut(recvShard, accumulated);
+            WaitForRequests();
+            Accumulate(accumulated, received, shardSizes[recvShard]);
+            std::swap(sending, accumulated);
+        }
+
+        copyIn(m_rank, sending);
+    }
+
+    // Copies the shard owned by every rank to all other ranks. 'copyOut' reads the owned shard, 'copyIn' replaces
+    // the values of a shard owned by another rank.
+    template <class ElemType>
+    void Allgather(const std::vector<size_t>& shardSizes, const ShardCopy<ElemType>& copyOut, const ShardCopy<ElemType>& copyIn)
+    {
+        CheckShardSizes(shardSizes);
+        if (m_numRanks == 1)
+            return;
+
+        ElemType* buffers[2];
+        ReserveBuffers(shardSizes, buffers, 2);
+        ElemType* sending = buffers[0];
+        ElemType* received = buffers[1];
+
+        // Every rank forwards the shard it received in the previous step.
+        copyOut(m_rank, sending);
+        for (int step = 0; step < m_numRanks - 1; ++step)
+        {
+            int sendShard = Wrap(m_rank - step);
+            int recvShard = Wrap(m_rank - 1 - step);
+            IsendChunked(m_mpi, sending, shardSizes[sendShard] * sizeof(ElemType), Wrap(m_rank + 1), ShardMessageTag, m_requests);
+            IrecvChunked(m_mpi, received, shardSizes[recvShard] * sizeof(ElemType), Wrap(m_rank - 1), ShardMessageTag, m_requests);
+            WaitForRequests();
+            copyIn(recvShard, received);
+            std::swap(sending, received);
+        }
+    }
+
+private:
+    int Wrap(int rank) const
+    {
+        return ((rank % m_numRanks) + m_numRanks) % m_numRanks;
+    }
+
+    void CheckShardSizes(const std::vector<size_t>& shardSizes) const
+    {
+        if (shardSizes.size() != (size_t)m_numRanks)
+            LogicError("ShardExchange: expected the sizes of %d shards, got %d.", m_numRanks, (int)shardSizes.size());
+    }
+
+    // Points 'buffers' to 'numBuffers' host buffers that each hold the largest shard.
+    template <class ElemType>
+    void ReserveBuffers(const std::vector<size_t>& shardSizes, ElemType** buffers, size_t numBuffers)
+    {
+        size_t maxShardSize = *std::max_element(shardSizes.begin(), shardSizes.end());
+        m_scratch.resize(std::max<size_t>(numBuffers * maxShardSize, 1) * sizeof(ElemType));
+        for (size_t i = 0; i < numBuffers; ++i)
+            buffers[i] = reinterpret_cast<ElemType*>(m_scratch.data()) + i * maxShardSize;
+    }
+
+    template <class ElemType>
+    static void Accumulate(ElemType* target, const ElemType* source, size_t numElements)
+    {
+        const long long n = (long long)numElements;
+#pragma omp parallel for
+        for (long long k = 0; k < n; ++k)
+            target[k] += source[k];
+    }
+
+    void WaitForRequests()
+    {
+        m_mpi.Waitall((int)m_requests.size(), m_requests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        m_requests.clear();
+    }
+
+    // Reserved tag, see MPITransfer.h.
+    static const int ShardMessageTag = FirstReservedMessageTag + 4;
+
+    MPIWrapper& m_mpi;
+    const int m_rank;
+    const int m_numRanks;
+
+    std::vector<MPI_Request> m_requests;
+    std::vector<char> m_scratch;
+};
+
+} } }
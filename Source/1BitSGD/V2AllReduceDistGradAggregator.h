@@ -14,6 +14,9 @@
 #include "QuantizedMatrix.h"
 #include "MatrixQuantizer.h"
 #include "MatrixQuantizerGPU.h"
+#include "QuantizedDistributedCommunicator.h"
+#include "AggregationProfiler.h"
+#include "FlatDistGradHeader.h"
 #include <future>
 #include "TimerUtility.h"
 
@@ -34,12 +37,20 @@ class V2AllReduceDistGradAggregator : public IDistGradAggregator<ElemType>
 
     static const int DEBUG_OUTPUT_TRACE_LEVEL = 3;
     ::CNTK::QuantizedDistributedCommunicatorPtr m_communicator;
+    ::CNTK::QuantizedMPICommunicatorImpl* m_mpiCommunicator;
 
 public:
     V2AllReduceDistGradAggregator(::CNTK::QuantizedDistributedCommunicatorPtr communicator, bool useAsyncAggregation, int traceLevel, int syncStatsTrace)
         : IDistGradAggregator<ElemType>(nullptr), m_traceLevel(traceLevel), m_initialized(false), m_useAsyncAggregation(useAsyncAggregation), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0),
-        m_communicator(communicator)
-    {}
+        m_numViewAllocations(0), m_communicator(communicator)
+    {
+        // The MPI communicator supports nonblocking header aggregation, others fall back to a blocking one.
+        m_mpiCommunicator = dynamic_cast<::CNTK::QuantizedMPICommunicatorImpl*>(m_communicator.get());
+
+        // The sync perf stats include a breakdown of the aggregation phases
+        if (m_syncStatsTrace > 0)
+            AggregationProfiler::Get().Enable(true);
+    }
 
     ~V2AllReduceDistGradAggregator()
     {
@@ -70,6 +81,26 @@ public:
             m_bufferedGradHeader = DistGradHeader::Create(numEvalNodes);
             m_bufferedGradHeader->Clear();
         }
+
+        // Build the views passed to the communicator once. With async aggregation the gradient buffers are swapped
+        // with the buffered matrices every iteration, so views of both buffers are kept for each gradient.
+        InitializeHeaderView(numEvalNodes);
+
+        m_gradientViews.resize(gradients.size());
+        m_gradientValues.resize(gradients.size());
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            GetGradientView(i, gradients[i]);
+            if (m_useAsyncAggregation)
+                GetGradientView(i, m_bufferedGradients[gradients[i]].get());
+        }
+    }
+
+    // Number of NDArrayViews this aggregator created for the communicator so far; stays constant once the steady state is reached.
+    // Buffers allocated by the communicator itself are not counted, it keeps its quantization buffers between aggregations on its own.
+    size_t NumViewAllocations() const
+    {
+        return m_numViewAllocations;
     }
 
     void ResetState(const std::vector<Matrix<ElemType>*>& gradients)
@@ -190,6 +221,10 @@ public:
 
     void AggregateGradientsImpl(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
     {
+        AggregationProfiler& profiler = AggregationProfiler::Get();
+        size_t profilerIteration = profiler.BeginIteration();
+        long long aggregationBeginNs = profiler.Now();
+
         Timer aggregationTimer;
         int deviceId = gradients[0]->GetDeviceId();
         if (showSyncPerfStats)
@@ -220,58 +255,94 @@ public:
         }
 
         // Aggregate header.
-        size_t numberOfElements = 1 + 1 + 1 + headerCPU->numEvalNode * 2;
-        std::unique_ptr<double[]> headerBuffer(new double[numberOfElements]);
-        headerBuffer[0] = headerCPU->criterion;
-        headerBuffer[1] = static_cast<double>(headerCPU->numSamples);
-        headerBuffer[2] = static_cast<double>(headerCPU->numSamplesWithLabel);
-        for (size_t i = 0; i < headerCPU->numEvalNode; ++i)
-        {
-            headerBuffer[3 + 2 * i] = headerCPU->evalErrors[i].first;
-            headerBuffer[3 + 2 * i + 1] = static_cast<double>(headerCPU->evalErrors[i].second);
-        }
-
-        auto headerData = ::CNTK::MakeSharedObject<::CNTK::NDArrayView>(::CNTK::DataType::Double, ::CNTK::NDShape{ numberOfElements }, headerBuffer.get(), numberOfElements * sizeof(double), ::CNTK::DeviceDescriptor::CPUDevice());
-        std::vector<::CNTK::NDArrayViewPtr> valuesToAggregate{ headerData };
+        if (m_headerBuffer.size() != FlatDistGradHeader::NumElements(headerCPU->numEvalNode))
+            InitializeHeaderView(headerCPU->numEvalNode);
 
-        // TODO: Should be async
-        m_communicator->AggregateInPlace(valuesToAggregate, m_communicator->Workers());
+        FlatDistGradHeader::Flatten(*headerCPU, m_headerBuffer.data());
 
-        // Copy data back to the header
-        headerCPU->criterion = headerBuffer[0];
-        headerCPU->numSamples = static_cast<size_t>(headerBuffer[1]);
-        headerCPU->numSamplesWithLabel = static_cast<size_t>(headerBuffer[2]);
-        for (size_t i = 0; i < headerCPU->numEvalNode; ++i)
-        {
-            headerCPU->evalErrors[i].first = headerBuffer[3 + 2 * i];
-            headerCPU->evalErrors[i].second = static_cast<size_t>(headerBuffer[3 + 2 * i + 1]);
-        }
+        // The header reduction is latency bound, so it proceeds while the gradients are being exchanged.
+        MPI_Request headerRequest = MPI_REQUEST_NULL;
+        long long headerBeginNs = profiler.Now();
+        if (m_mpiCommunicator)
+            m_mpiCommunicator->BeginAggregateInPlace(m_headerValues.front(), headerRequest);
+        else
+            m_communicator->AggregateInPlace(m_headerValues, m_communicator->Workers());
 
         // Aggregate gradients.
-        std::vector<::CNTK::NDArrayViewPtr> gradientValues;
+        if (m_gradientValues.size() != gradients.size())
+            LogicError("Number of gradients to aggregate changed after initialization of the aggregator.");
+
         for (size_t i = 0; i < gradients.size(); ++i)
+            m_gradientValues[i] = GetGradientView(i, gradients[i]);
+
+        try
+        {
+            m_communicator->QuantizedAggregateInPlace(
+                m_gradientValues,
+                m_residuals,
+                m_stripeResiduals,
+                m_communicator->Workers());
+        }
+        catch (...)
         {
-            assert(gradients[i]->Data() != nullptr);
-            ::CNTK::NDShape shape{ gradients[i]->GetNumRows(), gradients[i]->GetNumCols() };
-            auto data = ::CNTK::MakeSharedObject<::CNTK::NDArrayView>(::CNTK::AsDataType<ElemType>(), shape, gradients[i]->Data(), gradients[i]->GetNumElements() * sizeof(ElemType), ::CNTK::AsDeviceDescriptor(gradients[i]->GetDeviceId()));
-            gradientValues.push_back(data);
+            // The header buffer is reused by the next aggregation and a pending collective cannot be freed, so complete it first.
+            if (m_mpiCommunicator)
+                m_mpiCommunicator->EndAggregateInPlace(headerRequest);
+            throw;
         }
 
-        m_communicator->QuantizedAggregateInPlace(
-            gradientValues,
-            m_residuals,
-            m_stripeResiduals,
-            m_communicator->Workers());
+        if (m_mpiCommunicator)
+            m_mpiCommunicator->EndAggregateInPlace(headerRequest);
+        profiler.Record(AggregationPhase::Header, -1, headerBeginNs, profiler.Now());
+
+        // Copy data back to the header
+        FlatDistGradHeader::Unflatten(m_headerBuffer.data(), *headerCPU);
+
+        profiler.Record(AggregationPhase::Total, -1, aggregationBeginNs, profiler.Now());
 
         if (showSyncPerfStats)
         {
             aggregationTimer.Stop();
             double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
             fprintf(stderr, "Actual gradient aggregation time: %.6g\n", gradientAggregationTime);
+            profiler.PrintSummary(stderr, profilerIteration);
         }
     }
 
 private:
+    void InitializeHeaderView(int numEvalNodes)
+    {
+        size_t numberOfElements = FlatDistGradHeader::NumElements(numEvalNodes);
+        m_headerBuffer.assign(numberOfElements, 0.0);
+        auto headerData = ::CNTK::MakeSharedObject<::CNTK::NDArrayView>(::CNTK::DataType::Double, ::CNTK::NDShape{ numberOfElements }, m_headerBuffer.data(), numberOfElements * sizeof(double), ::CNTK::DeviceDescriptor::CPUDevice());
+        m_headerValues.assign(1, headerData);
+        m_numViewAllocations++;
+    }
+
+    // Returns the view of the gradient at the given position, creating it only if the gradient lives in a buffer
+    // not seen before or has been reshaped.
+    const ::CNTK::NDArrayViewPtr& GetGradientView(size_t index, Matrix<ElemType>* gradient)
+    {
+        assert(gradient->Data() != nullptr);
+        ::CNTK::NDShape shape{ gradient->GetNumRows(), gradient->GetNumCols() };
+        auto& views = m_gradientViews[index];
+        for (auto& view : views)
+        {
+            if (view.first == gradient->Data() && view.second->Shape() == shape)
+                return view.second;
+        }
+
+        // Keep the views of the two most recently seen buffers; evict the older one.
+        auto data = ::CNTK::MakeSharedObject<::CNTK::NDArrayView>(::CNTK::AsDataType<ElemType>(), shape, gradient->Data(), gradient->GetNumElements() * sizeof(ElemType), ::CNTK::AsDeviceDescriptor(gradient->GetDeviceId()));
+        m_numViewAllocations++;
+
+        if (views.size() == NumCachedViewsPerGradient)
+            views.erase(views.begin());
+
+        views.push_back(std::make_pair(gradient->Data(), data));
+        return views.back().second;
+    }
+
     // Perform asynchronous gradient aggregation using double buffering of the gradient matrices
     bool m_useAsyncAggregation;
 
@@ -294,6 +365,17 @@ private:
     std::vector<::CNTK::NDArrayViewPtr> m_residuals;
     // Residuals of quantized aggregated stripes this node is responsible for.
     std::vector<::CNTK::NDArrayViewPtr> m_stripeResiduals;
+
+    // Header buffer and its view, reused by every aggregation.
+    std::vector<double> m_headerBuffer;
+    std::vector<::CNTK::NDArrayViewPtr> m_headerValues;
+
+    // Views of the gradients keyed by the buffer they wrap, and the values handed to the communicator.
+    static const size_t NumCachedViewsPerGradient = 2;
+    std::vector<std::vector<std::pair<const ElemType*, ::CNTK::NDArrayViewPtr>>> m_gradientViews;
+    std::vector<::CNTK::NDArrayViewPtr> m_gradientValues;
+
+    size_t m_numViewAllocations;
 };
 
 } } }
@@ -6,6 +6,8 @@
 #pragma  once 
 
 #include "../SGDLib/MASGD.h"
+#include "MPITransfer.h"
+#include "CUDAPageLockedMemAllocator.h"
 #include <map>
 #include <string>
 #include <memory>
@@ -36,6 +38,26 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         std::map<std::wstring, std::shared_ptr<Matrix<ElemType>>> m_prevParameters;
         std::map<std::wstring, std::shared_ptr<Matrix<ElemType>>> m_blockLevelSmoothedGradient;
 
+        // Block gradients of all parameters are staged in one contiguous host buffer, page-locked for
+        // parameters on the GPU. Parameters, their range in the buffer and the views aggregated over
+        // it are resolved once per epoch, so syncs neither allocate nor look up names.
+        struct StagedParameter
+        {
+            ComputationNodeBasePtr m_node;
+            Matrix<ElemType>* m_prevWeight;
+            Matrix<ElemType>* m_smoothedGradient;
+            size_t m_offset;
+        };
+
+        std::vector<StagedParameter> m_stagedParameters;
+        size_t m_numLearnableNodes = 0;
+        std::unique_ptr<CUDAPageLockedMemAllocator> m_stagingAllocator;
+        ElemType* m_stagingBuffer = nullptr;
+        std::vector<ElemType> m_cpuStagingBuffer;
+        std::vector<::CNTK::NDArrayViewPtr> m_stagingViews;
+        // Device side block gradient of one parameter at a time; its buffer only grows.
+        std::shared_ptr<Matrix<ElemType>> m_blockGradientScratch;
+
     public:
         V2BlockMomentumSGD(const MPIWrapperPtr& pMPI,
             ::CNTK::DistributedCommunicatorPtr communicator,
@@ -58,6 +80,11 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                 InvalidArgument("Sync period is too small.");
         }
 
+        ~V2BlockMomentumSGD()
+        {
+            ReleaseStagingBuffer();
+        }
+
         void OnEpochStart(const std::list<ComputationNodeBasePtr>& learnableNodes) override
         {
             m_someWorkerHasFinished = false;
@@ -89,6 +116,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                 }
             }
 
+            PrepareStaging(learnableNodes);
+
             fprintf(stderr, "Parallel training (%d workers) using BlockMomentumSGD with "
                             "block momentum = %6.4f, "
                             "block momentum time constant (per worker) = %6.4f, "
@@ -167,56 +196,46 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             Timer commTimer;
             secondsOnCommunication = 0.0f;
 
+            if (m_stagedParameters.empty() || m_numLearnableNodes != learnableNodes.size())
+                PrepareStaging(learnableNodes);
+
             // 1. Let's aggregate weights
-            std::map<std::wstring, std::shared_ptr<Matrix<ElemType>>> aggregatedWeights;
-            std::vector<::CNTK::NDArrayViewPtr> aggregatedWeightsPrepared;
-            for (auto& pBaseNode : learnableNodes)
+            for (auto& staged : m_stagedParameters)
             {
-                if (!pBaseNode->IsParameterUpdateRequired())
-                    continue;
-
-                wstring name = pBaseNode->NodeName();
-                auto pNode = DownCast(pBaseNode);
-
                 // Get current model
-                Matrix<ElemType>& prevWeight = *m_prevParameters[name];                  // prev model value
-                Matrix<ElemType>& currentWeight = pNode->Value();                        // current model
-
-                // Subtract it from the previous model
-                auto blockGrad = std::make_shared<Matrix<ElemType>>(prevWeight, CPUDEVICE);
-                *blockGrad -= currentWeight;                                              // matW becomes local block gradient (of one worker)
-
-                aggregatedWeights[name] = blockGrad;
-                ::CNTK::NDShape shape{ blockGrad->GetNumElements() };
-                auto data = ::CNTK::MakeSharedObject<::CNTK::NDArrayView>(::CNTK::AsDataType<ElemType>(), shape, blockGrad->Data(), blockGrad->GetNumElements() * sizeof(ElemType), ::CNTK::AsDeviceDescriptor(blockGrad->GetDeviceId()));
-                aggregatedWeightsPrepared.push_back(data);
+                Matrix<ElemType>& prevWeight = *staged.m_prevWeight;                     // prev model value
+                Matrix<ElemType>& currentWeight = DownCast(staged.m_node)->Value();      // current model
+
+                // Subtract it from the previous model and stage it for sending
+                Matrix<ElemType>& blockGrad = BlockGradientScratch(currentWeight.GetDeviceId());
+                blockGrad.AssignDifferenceOf(prevWeight, currentWeight);                 // matW becomes local block gradient (of one worker)
+                ElemType* staging = m_stagingBuffer + staged.m_offset;
+                size_t numElements = blockGrad.GetNumElements();
+                blockGrad.CopyToArray(staging, numElements);
             }
 
             // Send block gradient over MPI nodes.
-            m_communicator->AggregateInPlace(aggregatedWeightsPrepared, m_communicator->Workers());
+            commTimer.Start();
+            m_communicator->AggregateInPlace(m_stagingViews, m_communicator->Workers());
+            commTimer.Stop();
+            secondsOnCommunication += (float)commTimer.ElapsedSeconds();
 
             // 2. Let's update the model
-            for (auto& pBaseNode : learnableNodes)
+            for (auto& staged : m_stagedParameters)
             {
-                if (!pBaseNode->IsParameterUpdateRequired())
-                    continue;
-
-                wstring name = pBaseNode->NodeName();
-                auto pNode = DownCast(pBaseNode);
-
                 // 2 block gradient aggregation
                 // 2.1. get current model
-                Matrix<ElemType>& prevWeight = *m_prevParameters[name];                  // prev model value
-                Matrix<ElemType>& currentWeight = pNode->Value();                        // current model
-                auto blockGrad = aggregatedWeights[name];
+                Matrix<ElemType>& prevWeight = *staged.m_prevWeight;                     // prev model value
+                Matrix<ElemType>& currentWeight = DownCast(staged.m_node)->Value();      // current model
+                Matrix<ElemType>& blockGrad = BlockGradientScratch(currentWeight.GetDeviceId());
+                blockGrad.SetValue(currentWeight.GetNumRows(), currentWeight.GetNumCols(), currentWeight.GetDeviceId(), m_stagingBuffer + staged.m_offset);
                 // 2.2. model update 
                 {
-                    Matrix<ElemType>& sg = *m_blockLevelSmoothedGradient[name];       // smoothed gradient
-                    blockGrad->TransferToDeviceIfNotThere(sg.GetDeviceId());
+                    Matrix<ElemType>& sg = *staged.m_smoothedGradient;       // smoothed gradient
                     // 2.2.1 update block level smoothed gradient; 
                     // This is essentially a first-order infinite impulse response (IIR) filter with the gain (1 - blockMomentum)*m_blockLearningRate:
                     // smoothedGradient(t)=blockMomentum * smoothedGradients(t-1) + (1 - blockMomentum)*m_blockLearningRate*blockGrad(t)
-                    Matrix<ElemType>::ScaleAndAdd((ElemType)((1 - blockMomentum)*m_blockLearningRate), *blockGrad, (ElemType)blockMomentum, sg);
+                    Matrix<ElemType>::ScaleAndAdd((ElemType)((1 - blockMomentum)*m_blockLearningRate), blockGrad, (ElemType)blockMomentum, sg);
                     // 2.2.2 update parameters; 
                     currentWeight.SetValue(prevWeight);
                     currentWeight -= sg;
@@ -294,12 +313,73 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BParam");
             LoadParameters(fstream, m_prevParameters, m_deviceId);
             LoadParameters(fstream, m_blockLevelSmoothedGradient, m_deviceId);
+            // The loaded matrices replace the ones the staged parameters refer to.
+            m_stagedParameters.clear();
             fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"EParam");
 
             fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EMACKP");
         }
 
     private:
+        void PrepareStaging(const std::list<ComputationNodeBasePtr>& learnableNodes)
+        {
+            m_stagedParameters.clear();
+            m_numLearnableNodes = learnableNodes.size();
+
+            size_t numElements = 0;
+            DEVICEID_TYPE deviceId = CPUDEVICE;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+
+                wstring name = pBaseNode->NodeName();
+                Matrix<ElemType>& value = DownCast(pBaseNode)->Value();
+                m_stagedParameters.push_back(StagedParameter{ pBaseNode, m_prevParameters.at(name).get(), m_blockLevelSmoothedGradient.at(name).get(), numElements });
+                numElements += value.GetNumElements();
+                deviceId = value.GetDeviceId();
+            }
+
+            ReleaseStagingBuffer();
+            if (deviceId != CPUDEVICE)
+            {
+                m_stagingAllocator.reset(new CUDAPageLockedMemAllocator(deviceId));
+                m_stagingBuffer = static_cast<ElemType*>(m_stagingAllocator->Malloc(std::max<size_t>(numElements, 1) * sizeof(ElemType)));
+            }
+            else
+            {
+                m_cpuStagingBuffer.resize(std::max<size_t>(numElements, 1));
+                m_stagingBuffer = m_cpuStagingBuffer.data();
+            }
+
+            // MPI counts are ints, so the staging buffer is aggregated in several chunks
+            m_stagingViews.clear();
+            const size_t maxChunkElements = MaxMessageChunkBytes / sizeof(ElemType);
+            for (size_t offset = 0; offset < numElements; offset += maxChunkElements)
+            {
+                size_t chunkElements = min(maxChunkElements, numElements - offset);
+                ::CNTK::NDShape shape{ chunkElements };
+                m_stagingViews.push_back(::CNTK::MakeSharedObject<::CNTK::NDArrayView>(::CNTK::AsDataType<ElemType>(), shape, m_stagingBuffer + offset, chunkElements * sizeof(ElemType), ::CNTK::DeviceDescriptor::CPUDevice()));
+            }
+        }
+
+        void ReleaseStagingBuffer()
+        {
+            m_stagingViews.clear();
+            if (m_stagingAllocator && m_stagingBuffer)
+                m_stagingAllocator->Free(m_stagingBuffer);
+
+            m_stagingAllocator.reset();
+            m_cpuStagingBuffer.clear();
+            m_stagingBuffer = nullptr;
+        }
+
+        Matrix<ElemType>& BlockGradientScratch(DEVICEID_TYPE deviceId)
+        {
+            if (!m_blockGradientScratch || m_blockGradientScratch->GetDeviceId() != deviceId)
+                m_blockGradientScratch = make_shared<Matrix<ElemType>>(deviceId);
+            return *m_blockGradientScratch;
+        }
 
        // helper function to save/load map<wstring, shared_ptr<Matrix<ElemType>> structure 
        void SaveParameters(File& f, const map<wstring, shared_ptr<Matrix<ElemType>>>& parameters) const